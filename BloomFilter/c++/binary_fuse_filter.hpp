@@ -0,0 +1,349 @@
+/*
+ * binary_fuse_filter.hpp
+ *
+ *
+ * Static Binary Fuse Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __BINARY_FUSE_FILTER__
+#define __BINARY_FUSE_FILTER__
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <cassert>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../hash/double_hash.hpp"
+
+
+// Immutable 3-wise binary fuse filter, as introduced in "Binary Fuse 
+// Filters: Fast and Smaller Than Xor Filters" by T. Graf and D. Lemire.
+//
+// The filter is built once from a complete key set and then only answers
+// exists(). Each key maps to three slots in consecutive segments, and
+// the slot contents are solved so that the XOR of a key's three slots is
+// its fingerprint. A lookup is three memory accesses. With 8 bit 
+// fingerprints this uses ~9 bits/key for a 0.39% false positive rate, 
+// with 16 bit ~18 bits/key for 0.0015%.
+//
+// Keys are hashed with MurmurHash3 (see double_hash.hpp). Construction
+// hashes and sorts the keys on several threads; the peeling itself is 
+// sequential but walks the slots in order, since the keys are sorted by
+// hash.
+template <class T, class F = uint8_t>
+class BinaryFuseFilter {
+public:
+
+  static_assert(sizeof(F) == 1 || sizeof(F) == 2, "fingerprints must be 8 or 16 bits");
+
+  static const uint32_t MAX_ATTEMPTS = 100;
+
+  // MurmurHash3 seed of the key hash. It is a uint32_t so that 
+  // DoubleHash(key, HASH_SEED) always hashes the key, whatever T is.
+  static const uint32_t HASH_SEED = 0;
+
+  BinaryFuseFilter() :
+    seed_(0),
+    segment_length_(0),
+    segment_mask_(0),
+    segment_count_length_(0),
+    size_(0) {}
+
+  // Build from keys[0, n), replacing any previous contents. Duplicate keys
+  // are allowed. Returns false if no solution was found (which in practice
+  // does not happen).
+  bool build(const T *keys, const uint64_t n, const uint32_t threads = 1) {
+    std::vector<uint64_t> hashes(n);
+
+    parallel(n, threads, [&](const uint64_t begin, const uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+          hashes[i] = DoubleHash(keys[i], HASH_SEED).h1();
+        }
+      });
+    sort(hashes, threads);
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    return (populate(hashes));
+  }
+
+  bool build(const std::vector<T> &keys, const uint32_t threads = 1) {
+    return (build(keys.data(), keys.size(), threads));
+  }
+
+  // Build from a file holding a flat array of T (which must be trivially
+  // copyable), mapped into memory rather than read. Returns false if the
+  // file can't be mapped or the build fails.
+  bool build_from_file(const char *path, const uint32_t threads = 1) {
+    struct stat st;
+    const int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+      return (false);
+    }
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(T)) {
+      close(fd);
+      return (false);
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      return (false);
+    }
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    const bool ret = build((const T *)p, st.st_size / sizeof(T), threads);
+    munmap(p, st.st_size);
+
+    return (ret);
+  }
+
+  bool exists(const T &s) const {
+    if (!size_) {
+      return (false);
+    }
+    
+    const uint64_t h = mix(DoubleHash(s, HASH_SEED).h1() + seed_);
+    uint32_t idx[3];
+
+    slots(h, idx);
+
+    return ((F)(fingerprint(h) ^ array_[idx[0]] ^ array_[idx[1]] ^ array_[idx[2]]) == 0);
+  }
+
+  // number of distinct keys
+  uint64_t size() const {
+    return (size_);
+  }
+
+  // bytes used by the fingerprints
+  uint64_t memory() const {
+    return (array_.size() * sizeof(F));
+  }
+
+  double expected_fpp() const {
+    return (1.0 / ((uint64_t)1 << (sizeof(F) * 8)));
+  }
+
+protected:
+
+  static inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return (h);
+  }
+
+  static inline F fingerprint(const uint64_t h) {
+    return ((F)(h ^ (h >> 32)));
+  }
+
+  // the three slots of a hash: one per consecutive segment
+  inline void slots(const uint64_t h, uint32_t *idx) const {
+    const uint64_t base = (uint64_t)(((unsigned __int128)h * segment_count_length_) >> 64);
+
+    idx[0] = (uint32_t)base;
+    idx[1] = (uint32_t)((base + segment_length_) ^ ((h >> 18) & segment_mask_));
+    idx[2] = (uint32_t)((base + 2 * segment_length_) ^ (h & segment_mask_));
+  }
+
+  // run f(begin, end) over [0, n) split across threads
+  template <class Fn>
+  static void parallel(const uint64_t n, const uint32_t threads, Fn f) {
+    const uint32_t t = threads ? threads : 1;
+    const uint64_t chunk = (n + t - 1) / t;
+    std::vector<std::thread> pool;
+
+    for (uint32_t i = 1; i < t && i * chunk < n; ++i) {
+      pool.push_back(std::thread(f, i * chunk, std::min(n, (i + 1) * chunk)));
+    }
+    f(0, std::min(n, chunk));
+    for (uint32_t i = 0; i < pool.size(); ++i) {
+      pool[i].join();
+    }
+  }
+
+  // sort a chunk per thread, then merge the runs pairwise
+  static void sort(std::vector<uint64_t> &v, const uint32_t threads) {
+    const uint32_t t = threads ? threads : 1;
+    const uint64_t chunk = (v.size() + t - 1) / t;
+
+    parallel(v.size(), t, [&v](const uint64_t begin, const uint64_t end) {
+        std::sort(v.begin() + begin, v.begin() + end);
+      });
+    for (uint64_t width = chunk; chunk && width < v.size(); width *= 2) {
+      for (uint64_t begin = 0; begin + width < v.size(); begin += 2 * width) {
+        std::inplace_merge(v.begin() + begin, v.begin() + begin + width,
+                           v.begin() + std::min((uint64_t)v.size(), begin + 2 * width));
+      }
+    }
+  }
+
+  void size_for(const uint64_t n) {
+    const double factor = n > 1 ? std::max(1.125, 0.875 + 0.25 * std::log(1e6) / std::log((double)n)) : 2.0;
+    const uint64_t capacity = (uint64_t)std::floor(n * factor + 0.5);
+
+    segment_length_ = n ? (uint32_t)1 << (int)std::floor(std::log((double)n) / std::log(3.33) + 2.25) : 4;
+    segment_length_ = std::max(4u, std::min(262144u, segment_length_));
+    segment_mask_ = segment_length_ - 1;
+
+    const uint64_t segments = (capacity + segment_length_ - 1) / segment_length_;
+    const uint64_t segment_count = segments > 2 ? segments - 2 : 1;
+
+    segment_count_length_ = segment_count * segment_length_;
+    array_.assign((segment_count + 2) * segment_length_, 0);
+  }
+
+  // Solve for the slot contents given the sorted, distinct key hashes
+  bool populate(const std::vector<uint64_t> &hashes) {
+    const uint64_t n = hashes.size();
+
+    size_for(n);
+    size_ = n;
+    if (!n) {
+      return (true);
+    }
+
+    const uint64_t len = array_.size();
+    assert(len < ((uint64_t)1 << 32));
+    // per slot: number of keys << 2 | xor of their position (0, 1, 2) in 
+    // the key's slot triple, and xor of their hashes
+    std::vector<uint32_t> count(len);
+    std::vector<uint64_t> xors(len);
+    std::vector<uint32_t> alone(len);
+    std::vector<uint64_t> order(n);
+    std::vector<uint8_t> position(n);
+    uint32_t idx[5];
+
+    for (uint32_t attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+      seed_ = mix(attempt + 0x9e3779b97f4a7c15ULL);
+      std::fill(count.begin(), count.end(), 0);
+      std::fill(xors.begin(), xors.end(), 0);
+
+      for (uint64_t i = 0; i < n; ++i) {
+        const uint64_t h = mix(hashes[i] + seed_);
+
+        slots(h, idx);
+        for (uint32_t j = 0; j < 3; ++j) {
+          count[idx[j]] = (count[idx[j]] + 4) ^ j;
+          xors[idx[j]] ^= h;
+        }
+      }
+
+      // peel slots holding a single key until none are left
+      uint64_t queued = 0;
+      uint64_t peeled = 0;
+      for (uint64_t i = 0; i < len; ++i) {
+        alone[queued] = (uint32_t)i;
+        queued += (count[i] >> 2) == 1;
+      }
+      
+      while (queued) {
+        const uint32_t slot = alone[--queued];
+
+        if ((count[slot] >> 2) != 1) {
+          continue;
+        }
+
+        const uint64_t h = xors[slot];
+        const uint8_t found = count[slot] & 3;
+
+        slots(h, idx);
+        idx[3] = idx[0];
+        idx[4] = idx[1];
+        order[peeled] = h;
+        position[peeled] = found;
+        ++peeled;
+
+        for (uint32_t j = 1; j < 3; ++j) {
+          const uint32_t other = idx[found + j];
+
+          alone[queued] = other;
+          queued += (count[other] >> 2) == 2;
+          count[other] = (count[other] - 4) ^ ((found + j) % 3);
+          xors[other] ^= h;
+        }
+      }
+
+      if (peeled == n) {
+        // assign in reverse peeling order, so each key's slot is the last
+        // of its three to be written
+        for (uint64_t i = n; i-- > 0;) {
+          const uint64_t h = order[i];
+          const uint8_t found = position[i];
+
+          slots(h, idx);
+          idx[3] = idx[0];
+          idx[4] = idx[1];
+          array_[idx[found]] = fingerprint(h) ^ array_[idx[found + 1]] ^ array_[idx[found + 2]];
+        }
+
+        return (true);
+      }
+    }
+
+    size_ = 0;
+    return (false);
+  }
+
+  uint64_t seed_;
+  uint32_t segment_length_;
+  uint32_t segment_mask_;
+  uint64_t segment_count_length_;
+  // distinct keys
+  uint64_t size_;
+  std::vector<F> array_;
+};
+
+
+#endif
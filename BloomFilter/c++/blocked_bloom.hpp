@@ -0,0 +1,246 @@
+/*
+ * blocked_bloom.hpp
+ *
+ *
+ * Cache Line Blocked Bloom Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __BLOCKED_BLOOM_FILTER__
+#define __BLOCKED_BLOOM_FILTER__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+
+
+// Every key maps to a single 64 byte block (one cache line) made of eight
+// 64 bit words, and sets exactly one bit in each word. The word bits come 
+// from multiplying 32 bits of hash with a fixed odd salt per word, so the
+// whole in-block mask can be built with a handful of vector instructions.
+template <class S, class T>
+class BlockedBloomFilter : public StaticBloom<BlockedBloomFilter<S,T>, S, T> {
+public:
+  typedef S (*hash_function)(const T &s);
+
+  static const uint32_t BLOCK_WORDS = 8;
+  static const uint32_t BLOCK_BITS = BLOCK_WORDS * 64;
+
+  BlockedBloomFilter(const uint64_t expected_n, const double fpp, const hash_function &hash) :
+    blocks_(blocks_for(expected_n, fpp)),
+    array_(blocks_ * BLOCK_WORDS + BLOCK_WORDS - 1, 0),
+    hash_(hash),
+    expected_n_(expected_n) {}
+
+  BlockedBloomFilter(const BlockedBloomFilter<S,T> &s) :
+    blocks_(s.blocks_),
+    array_(blocks_ * BLOCK_WORDS + BLOCK_WORDS - 1, 0),
+    hash_(s.hash_),
+    expected_n_(s.expected_n_)
+  {
+    std::copy(s.block(0), s.block(0) + blocks_ * BLOCK_WORDS, block(0));
+  }
+
+  // the backing store is over-allocated and aligned by hand, so copies
+  // must go through block() rather than copying the vector verbatim
+  BlockedBloomFilter<S,T> &operator=(const BlockedBloomFilter<S,T> &s) {
+    if (this != &s) {
+      blocks_ = s.blocks_;
+      array_.assign(blocks_ * BLOCK_WORDS + BLOCK_WORDS - 1, 0);
+      hash_ = s.hash_;
+      expected_n_ = s.expected_n_;
+      std::copy(s.block(0), s.block(0) + blocks_ * BLOCK_WORDS, block(0));
+    }
+
+    return (*this);
+  }
+
+  void add(const T &s) {
+    const uint64_t h = mix((*hash_)(s));
+    uint64_t *b = block(fast_range((uint32_t)(h >> 32), blocks_));
+
+#if defined(__AVX2__)
+    __m256i lo, hi;
+    make_mask(h, lo, hi);
+
+    _mm256_store_si256((__m256i *)b, _mm256_or_si256(_mm256_load_si256((__m256i *)b), lo));
+    _mm256_store_si256((__m256i *)(b + 4), _mm256_or_si256(_mm256_load_si256((__m256i *)(b + 4)), hi));
+#else
+    for (uint32_t i = 0; i < BLOCK_WORDS; ++i) {
+      b[i] |= word_mask((uint32_t)h, i);
+    }
+#endif
+  }
+
+  bool exists(const T &s) const {
+    const uint64_t h = mix((*hash_)(s));
+    const uint64_t *b = block(fast_range((uint32_t)(h >> 32), blocks_));
+
+#if defined(__AVX2__)
+    __m256i lo, hi;
+    make_mask(h, lo, hi);
+
+    return (_mm256_testc_si256(_mm256_load_si256((const __m256i *)b), lo) &
+            _mm256_testc_si256(_mm256_load_si256((const __m256i *)(b + 4)), hi));
+#else
+    uint64_t missing = 0;
+    for (uint32_t i = 0; i < BLOCK_WORDS; ++i) {
+      const uint64_t m = word_mask((uint32_t)h, i);
+      missing |= m & ~b[i];
+    }
+
+    return (!missing);
+#endif
+  }
+
+  // number of bits in the filter
+  uint64_t size() const {
+    return (blocks_ * BLOCK_BITS);
+  }
+
+  // bytes used by the block array
+  uint64_t memory() const {
+    return (blocks_ * BLOCK_WORDS * sizeof(uint64_t));
+  }
+
+  // false positive rate once expected_n items have been added
+  double expected_fpp() const {
+    return (blocked_fpp(size(), expected_n_));
+  }
+
+  // False positive rate of a blocked filter with m bits and n items: the
+  // number of keys landing in a block is Poisson distributed, and each
+  // block behaves like a 512 bit filter with one bit per word.
+  static double blocked_fpp(const uint64_t m, const uint64_t n) {
+    const double lambda = (double)n * BLOCK_BITS / m;
+    const uint32_t limit = (uint32_t)(lambda + 10 * std::sqrt(lambda) + 20);
+    double poisson = std::exp(-lambda);
+    double ret = 0.0;
+
+    for (uint32_t i = 0; i <= limit; ++i) {
+      ret += poisson * std::pow(1.0 - std::pow(63.0 / 64.0, (double)i), (double)BLOCK_WORDS);
+      poisson *= lambda / (i + 1);
+    }
+
+    return (ret);
+  }
+
+protected:
+
+  static uint64_t blocks_for(const uint64_t n, const double fpp) {
+    uint64_t blocks = (bloom_optimal_bits(n, fpp) + BLOCK_BITS - 1) / BLOCK_BITS;
+
+    // blocking costs some accuracy, grow until the target is met
+    while (blocked_fpp(blocks * BLOCK_BITS, n) > fpp) {
+      blocks += blocks / 32 + 1;
+    }
+
+    return (blocks);
+  }
+
+  // spread the (possibly narrow) user hash across 64 bits
+  static inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return (h);
+  }
+
+  static inline uint64_t word_mask(const uint32_t h, const uint32_t i) {
+    return ((uint64_t)1 << ((uint32_t)(h * salt(i)) >> 26));
+  }
+
+  static inline uint32_t salt(const uint32_t i) {
+    static const uint32_t salts[BLOCK_WORDS] = {
+      0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+      0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+
+    return (salts[i]);
+  }
+
+#if defined(__AVX2__)
+  static inline void make_mask(const uint64_t h, __m256i &lo, __m256i &hi) {
+    const __m256i salts = _mm256_setr_epi32(0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                                            0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31);
+    const __m256i ones = _mm256_set1_epi64x(1);
+    __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((uint32_t)h), salts), 26);
+
+    lo = _mm256_sllv_epi64(ones, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+    hi = _mm256_sllv_epi64(ones, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+  }
+#endif
+
+  inline uint64_t *block(const uint64_t i) {
+    return (aligned() + i * BLOCK_WORDS);
+  }
+
+  inline const uint64_t *block(const uint64_t i) const {
+    return (const_cast<BlockedBloomFilter<S,T> *>(this)->aligned() + i * BLOCK_WORDS);
+  }
+
+  // first cache line aligned word of the backing store
+  inline uint64_t *aligned() {
+    return ((uint64_t *)(((uintptr_t)array_.data() + 63) & ~(uintptr_t)63));
+  }
+
+  uint64_t blocks_;
+  std::vector<uint64_t> array_;
+  hash_function hash_;
+  uint64_t expected_n_;
+};
+
+
+#endif
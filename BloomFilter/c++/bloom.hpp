@@ -50,56 +50,309 @@
 #define __BLOOM_FILTER__
 
 #include <vector>
+#include <algorithm>
 #include <limits>
 #include <cassert>
 #include <stdint.h>
 
 
 #include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
 
 template <class S, class T>
-class BloomFilter : Bloom<S, T> {
+class BloomFilter : public StaticBloom<BloomFilter<S,T>, S, T> {
 public:
   typedef S (*hash_function)(const T &s);
     
-    
+  // Legacy sizing: one bit for every value of S (S must be narrower than 64 bits)
   BloomFilter(const std::vector<hash_function> &hash_list) : 
-    bloom_array_(std::numeric_limits<S>::max(), false), 
-    hash_list_(hash_list) {}
+    bloom_array_(full_range()), 
+    hash_list_(hash_list),
+    expected_n_(0),
+    k_(0),
+    seed_(0) {}
+
+  BloomFilter() : bloom_array_(full_range()),
+          hash_list_(std::vector<hash_function>(0)),
+          expected_n_(0),
+          k_(0),
+          seed_(0) {}
+
+  // Size the filter for expected_n items at a false positive rate of fpp.
+  // optimal_hashes() reports how many hash functions should be supplied.
+  BloomFilter(const uint64_t expected_n, const double fpp, 
+              const std::vector<hash_function> &hash_list = std::vector<hash_function>(0)) :
+    bloom_array_(bloom_optimal_bits(expected_n, fpp)),
+    hash_list_(hash_list),
+    expected_n_(expected_n),
+    k_(0),
+    seed_(0) {}
 
-  BloomFilter() : bloom_array_(std::numeric_limits<S>::max(), false),
-          hash_list_(std::vector<hash_function>(0)) {}
+  // Size the filter as above, and derive all optimal_hashes() indices from
+  // a single 128 bit MurmurHash3 of the key (see double_hash.hpp) instead
+  // of calling a list of hash functions.
+  BloomFilter(const uint64_t expected_n, const double fpp, const uint32_t seed) :
+    bloom_array_(bloom_optimal_bits(expected_n, fpp)),
+    expected_n_(expected_n),
+    k_(bloom_optimal_hashes(bloom_array_.size(), expected_n)),
+    seed_(seed) {}
 
   void setHash(const std::vector<hash_function> &hash_list) {
-    hash_list_(hash_list);
+    hash_list_ = hash_list;
   }
 
   void addHash(const hash_function &hash) {
     hash_list_.push_back(hash);
   }
         
-  virtual void add(const T &s) {
-    assert(hash_list_.size());
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      bloom_array_[(*hash_list_[i])(s)] = true;
+  void add(const T &s) {
+    assert(hashes());
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      bloom_array_.set(index(s, h, i));
     }
   }
     
-  virtual bool exists(const T &s) const {
-    assert(hash_list_.size());
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      if (!bloom_array_[(*hash_list_[i])(s)]) {
+  bool exists(const T &s) const {
+    assert(hashes());
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      if (!bloom_array_.test(index(s, h, i))) {
     return (false);
       }
     }
     
     return (true);
   }
+
+  // Add keys[0, n). The indices of BLOOM_BATCH_SIZE keys are computed and
+  // prefetched before any of them is set, so their cache misses overlap.
+  // Bit i of the returned bitmap is set if keys[i] was already present.
+  std::vector<uint64_t> add_batch(const T *keys, const uint64_t n) {
+    assert(hashes());
+    std::vector<uint64_t> ret((n + 63) >> 6, 0);
+    std::vector<uint64_t> idx(BLOOM_BATCH_SIZE * hashes());
+    const uint32_t k = hashes();
+
+    for (uint64_t b = 0; b < n; b += BLOOM_BATCH_SIZE) {
+      const uint64_t len = std::min(BLOOM_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &idx[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        uint64_t present = 1;
+
+        for (uint32_t i = 0; i < k; ++i) {
+          present &= bloom_array_.test(idx[j * k + i]);
+          bloom_array_.set(idx[j * k + i]);
+        }
+        ret[(b + j) >> 6] |= present << ((b + j) & 63);
+      }
+    }
+
+    return (ret);
+  }
+
+  // Test keys[0, n), as add_batch. Bit i of the returned bitmap is set if
+  // keys[i] may be present.
+  std::vector<uint64_t> exists_batch(const T *keys, const uint64_t n) const {
+    assert(hashes());
+    std::vector<uint64_t> ret((n + 63) >> 6, 0);
+    std::vector<uint64_t> idx(BLOOM_BATCH_SIZE * hashes());
+    const uint32_t k = hashes();
+
+    for (uint64_t b = 0; b < n; b += BLOOM_BATCH_SIZE) {
+      const uint64_t len = std::min(BLOOM_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &idx[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        uint64_t present = 1;
+
+        for (uint32_t i = 0; i < k; ++i) {
+          present &= bloom_array_.test(idx[j * k + i]);
+        }
+        ret[(b + j) >> 6] |= present << ((b + j) & 63);
+      }
+    }
+
+    return (ret);
+  }
+
+  // True when o has the same size and hashing, so bit i means the same
+  // thing in both filters
+  bool compatible(const BloomFilter<S,T> &o) const {
+    return (size() == o.size() && k_ == o.k_ && seed_ == o.seed_ && hash_list_ == o.hash_list_);
+  }
+
+  // Add every key of o (bitwise OR). Returns false, changing nothing, if
+  // the filters are not compatible.
+  bool merge_union(const BloomFilter<S,T> &o) {
+    if (!compatible(o)) {
+      return (false);
+    }
+    bloom_array_.merge_or(o.bloom_array_);
+
+    return (true);
+  }
+
+  // Merge many shards in one pass: the array is walked in blocks that
+  // stay in cache while every shard is ORed into them, so each word is
+  // written once rather than once per shard.
+  bool merge_union(const std::vector<const BloomFilter<S,T> *> &shards) {
+    const uint64_t block = 4096;
+    const uint64_t words = bloom_array_.words();
+
+    for (uint64_t i = 0; i < shards.size(); ++i) {
+      if (!compatible(*shards[i])) {
+        return (false);
+      }
+    }
+
+    for (uint64_t b = 0; b < words; b += block) {
+      const uint64_t len = std::min(block, words - b);
+
+      for (uint64_t i = 0; i < shards.size(); ++i) {
+        bloom_or(bloom_array_.data() + b, shards[i]->bloom_array_.data() + b, len);
+      }
+    }
+
+    return (true);
+  }
+
+  // Keep only bits set in both filters (bitwise AND). This may report 
+  // more keys than the true intersection, never fewer. Returns false if
+  // the filters are not compatible.
+  bool intersect(const BloomFilter<S,T> &o) {
+    if (!compatible(o)) {
+      return (false);
+    }
+    bloom_array_.merge_and(o.bloom_array_);
+
+    return (true);
+  }
+
+  // number of bits set
+  uint64_t popcount() const {
+    return (bloom_array_.popcount());
+  }
+
+  // fraction of bits set
+  double fill_ratio() const {
+    return ((double)popcount() / size());
+  }
+
+  // estimated number of distinct keys added
+  double estimate_cardinality() const {
+    return (bloom_cardinality(size(), popcount(), hashes()));
+  }
+
+  // number of bits in the filter
+  uint64_t size() const {
+    return (bloom_array_.size());
+  }
+
+  // bytes used by the bit array
+  uint64_t memory() const {
+    return (bloom_array_.memory());
+  }
+
+  uint32_t optimal_hashes() const {
+    return (expected_n_ ? bloom_optimal_hashes(size(), expected_n_) : hashes());
+  }
+
+  // number of indices probed per key
+  uint32_t hashes() const {
+    return (k_ ? k_ : (uint32_t)hash_list_.size());
+  }
+
+  // false positive rate once expected_n items have been added
+  double expected_fpp() const {
+    return (bloom_fpp(size(), expected_n_, hashes()));
+  }
+
+  // Write the filter to path (see bloom_file.hpp). Hash functions can't
+  // be saved: a filter using a hash_list must be loaded into one
+  // constructed with the same list.
+  bool save(const char *path) const {
+    BloomFileHeader h = bloom_file_header(BLOOM_FILE_BITS, 1, size(), bloom_array_.words());
+
+    h.expected_n = expected_n_;
+    h.hashes = hashes();
+    h.seed = seed_;
+    h.flags = k_ ? BLOOM_FILE_DOUBLE_HASH : 0;
+
+    return (bloom_file_save(path, h, bloom_array_.data()));
+  }
+
+  // Replace this filter with the one saved at path. The file is mapped
+  // and queried in place rather than read, so this takes constant time 
+  // and processes opening the same file share its pages. verify also 
+  // checksums the whole array. Returns false, changing nothing, if the 
+  // file is not a valid BloomFilter or needs a different number of hash
+  // functions than hash_list holds.
+  bool load(const char *path, const bool verify = false) {
+    BloomFileHeader h;
+    BloomWords words;
+
+    if (!bloom_file_open(path, h, words, verify) || h.type != BLOOM_FILE_BITS ||
+        h.counter_bits != 1 || !h.size || !h.hashes ||
+        h.words != BloomBitArray::words_for(h.size)) {
+      return (false);
+    }
+    if (!(h.flags & BLOOM_FILE_DOUBLE_HASH) && h.hashes != hash_list_.size()) {
+      return (false);
+    }
+
+    bloom_array_ = BloomBitArray(h.size, std::move(words));
+    expected_n_ = h.expected_n;
+    k_ = (h.flags & BLOOM_FILE_DOUBLE_HASH) ? h.hashes : 0;
+    seed_ = h.seed;
+
+    return (true);
+  }
+
+  // true when the filter is queried in place from a loaded file
+  bool mapped() const {
+    return (bloom_array_.mapped());
+  }
     
 private:
+
+  static uint64_t full_range() {
+    assert(sizeof(S) < sizeof(uint64_t));
+    return ((uint64_t)std::numeric_limits<S>::max() + 1);
+  }
+
+  inline uint64_t index(const T &s, const DoubleHash &h, const uint32_t i) const {
+    if (k_) {
+      return (fast_range(h[i], bloom_array_.size()));
+    }
+
+    return (fast_range((*hash_list_[i])(s), bloom_array_.size()));
+  }
+
+  // compute and prefetch the hashes() indices of each of the n keys
+  void hash_batch(const T *keys, const uint64_t n, uint64_t *idx) const {
+    const uint32_t k = hashes();
+
+    for (uint64_t j = 0; j < n; ++j) {
+      const DoubleHash h = k_ ? DoubleHash(keys[j], seed_) : DoubleHash();
+
+      for (uint32_t i = 0; i < k; ++i) {
+        idx[j * k + i] = index(keys[j], h, i);
+        bloom_array_.prefetch(idx[j * k + i]);
+      }
+    }
+  }
   
-  std::vector<bool> bloom_array_;
+  BloomBitArray bloom_array_;
   std::vector<hash_function> hash_list_;
+  uint64_t expected_n_;
+  // number of double hashed indices, 0 when hash_list_ is used
+  uint32_t k_;
+  uint32_t seed_;
 };
 
 
@@ -50,13 +50,127 @@
 #ifndef __BLOOM_FILTER_INTERFACE__
 #define __BLOOM_FILTER_INTERFACE__
 
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+
+
+// Dynamic interface, for code that must pick a filter type at runtime.
+// The filters themselves do not derive from it (see StaticBloom); wrap
+// one in AnyBloom to get a Bloom<S,T>.
 template <class S, class T>
 class Bloom {
 public:
     
+  virtual ~Bloom() {}
+
   virtual void add(const T &s) = 0;
   virtual bool exists(const T &s) const = 0;
 
 };
 
+
+// Static interface. Filters derive from StaticBloom<Filter, S, T> and 
+// define add/exists as ordinary member functions, so code templated on 
+// the filter type calls them directly and can inline the probe loop.
+template <class Derived, class S, class T>
+class StaticBloom {
+public:
+
+  // add every key in [first, last)
+  template <class It>
+  void add_range(It first, const It last) {
+    for (; first != last; ++first) {
+      derived().add(*first);
+    }
+  }
+
+  // number of keys in [first, last) that may be present
+  template <class It>
+  uint64_t count_present(It first, const It last) const {
+    uint64_t ret = 0;
+
+    for (; first != last; ++first) {
+      ret += derived().exists(*first);
+    }
+
+    return (ret);
+  }
+
+protected:
+
+  Derived &derived() {
+    return (static_cast<Derived &>(*this));
+  }
+
+  const Derived &derived() const {
+    return (static_cast<const Derived &>(*this));
+  }
+};
+
+
+// is_bloom<F, T>::value is true when F has add(const T&) and 
+// exists(const T&) const, for checking filter template parameters
+template <class F, class T>
+class is_bloom {
+private:
+  
+  template <class U>
+  static auto test(int) -> decltype(std::declval<U &>().add(std::declval<const T &>()),
+                                    (bool)std::declval<const U &>().exists(std::declval<const T &>()),
+                                    std::true_type());
+
+  template <class U>
+  static std::false_type test(...);
+
+public:
+
+  static const bool value = decltype(test<F>(0))::value;
+};
+
+
+// Type erased reference to any filter with add/exists, for the rare case
+// where the filter type is only known at runtime. The filter must outlive
+// the AnyBloom (and every copy of it).
+template <class S, class T>
+class AnyBloom : public Bloom<S, T>, public StaticBloom<AnyBloom<S, T>, S, T> {
+public:
+
+  template <class F, class = typename std::enable_if<!std::is_same<F, AnyBloom<S, T> >::value>::type>
+  AnyBloom(F &filter) : impl_(new Model<F>(filter)) {
+    static_assert(is_bloom<F, T>::value, "F must provide add(const T&) and exists(const T&) const");
+  }
+
+  virtual void add(const T &s) {
+    impl_->add(s);
+  }
+
+  virtual bool exists(const T &s) const {
+    return (impl_->exists(s));
+  }
+
+private:
+
+  template <class F>
+  class Model : public Bloom<S, T> {
+  public:
+
+    Model(F &filter) : filter_(filter) {}
+
+    virtual void add(const T &s) {
+      filter_.add(s);
+    }
+
+    virtual bool exists(const T &s) const {
+      return (filter_.exists(s));
+    }
+
+  private:
+    F &filter_;
+  };
+
+  std::shared_ptr<Bloom<S, T> > impl_;
+};
+
 #endif
@@ -50,9 +50,16 @@
 
 #include <stdint.h>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 
+#include "bloom_file.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 template <class T = uint64_t>
 class BloomArray {
 
@@ -61,7 +68,7 @@ public:
   BloomArray(const T &elements, const T &bits_per_element = 1) :
     array_(ceil(elements * bits_per_element / (sizeof(T) * 8.0)), 0),
     elem_bits_(bits_per_element),
-    elem_mask_(pow(2, bits_per_element) - 1),
+    elem_mask_(((T)1 << bits_per_element) - 1),
     bitcount_(sizeof(T) << 3),
     len_(elements)
   { 
@@ -132,6 +139,10 @@ public:
     array_[idx >> index_shift_] |= value;
   }
 
+  void prefetch(const T &index) const {
+    __builtin_prefetch(&array_[index_translate(index) >> index_shift_]);
+  }
+
   T size() const {
     return (len_);
   }
@@ -154,14 +165,7 @@ protected:
   }
 
   inline uint32_t log2(const uint32_t x) const {
-    uint32_t ret;
-    
-    asm ( "\tbsr %1, %0\n"
-	  : "=r" (ret)
-	  : "r"  (x)
-        );
-    
-    return (ret);
+    return (31 - __builtin_clz(x));
   }
   
   // Array that holds the underlying datatype elements
@@ -179,4 +183,258 @@ protected:
 };
 
 
+
+// Array of saturating counters of a fixed width (1, 2, 4 or 8 bits) packed
+// into 64 bit words. The width is a template parameter, so every index
+// computation is a constant shift and mask.
+template <uint32_t Bits = 4>
+class PackedBloomArray {
+public:
+
+  static_assert(Bits == 1 || Bits == 2 || Bits == 4 || Bits == 8,
+                "counter width must be 1, 2, 4 or 8 bits");
+
+  static const uint64_t MAX = ((uint64_t)1 << Bits) - 1;
+  // counters per word, and its log2
+  static const uint64_t PER_WORD = 64 / Bits;
+  static const uint32_t WORD_SHIFT = Bits == 1 ? 6 : Bits == 2 ? 5 : Bits == 4 ? 4 : 3;
+
+  PackedBloomArray(const uint64_t elements) :
+    array_(words_for(elements)),
+    len_(elements)
+  {
+    assert(elements);
+  }
+
+  // counters backed by words, e.g. a mapped file (see bloom_file.hpp)
+  PackedBloomArray(const uint64_t elements, BloomWords words) :
+    array_(std::move(words)),
+    len_(elements)
+  {
+    assert(elements);
+    assert(array_.size() == words_for(elements));
+  }
+
+  // number of words needed for elements counters
+  static uint64_t words_for(const uint64_t elements) {
+    return ((elements + PER_WORD - 1) >> WORD_SHIFT);
+  }
+
+  inline uint64_t at(const uint64_t index) const {
+    return ((array_[word(index)] >> shift(index)) & MAX);
+  }
+
+  // saturates at MAX
+  inline void inc(const uint64_t index) {
+    uint64_t &w = array_[word(index)];
+    const uint32_t sh = shift(index);
+
+    w += (uint64_t)(((w >> sh) & MAX) != MAX) << sh;
+  }
+
+  // saturates at 0
+  inline void dec(const uint64_t index) {
+    uint64_t &w = array_[word(index)];
+    const uint32_t sh = shift(index);
+
+    w -= (uint64_t)(((w >> sh) & MAX) != 0) << sh;
+  }
+
+  void set(const uint64_t index, const uint64_t value) {
+    if (value > MAX) {
+      return;
+    }
+
+    uint64_t &w = array_[word(index)];
+    const uint32_t sh = shift(index);
+
+    w = (w & ~(MAX << sh)) | (value << sh);
+  }
+
+  // inc/dec every counter in indices[0, n). Word offsets and shifts are
+  // computed and prefetched for a block of indices before any counter is
+  // updated.
+  void inc_bulk(const uint64_t *indices, const uint64_t n) {
+    bulk<true>(indices, n);
+  }
+
+  void dec_bulk(const uint64_t *indices, const uint64_t n) {
+    bulk<false>(indices, n);
+  }
+
+  inline void prefetch(const uint64_t index) const {
+    __builtin_prefetch(&array_[word(index)]);
+  }
+
+  void clear() {
+    std::fill(array_.begin(), array_.end(), 0);
+  }
+
+  // Counter-wise saturating sum with an array of the same size
+  void merge_add(const PackedBloomArray<Bits> &o) {
+    assert(len_ == o.len_);
+    merge<true>(o);
+  }
+
+  // Counter-wise minimum with an array of the same size
+  void merge_min(const PackedBloomArray<Bits> &o) {
+    assert(len_ == o.len_);
+    merge<false>(o);
+  }
+
+  // number of counters that are not 0
+  uint64_t nonzero() const {
+    // fold every counter onto its lowest bit
+    const uint64_t low = lane_low();
+    uint64_t ret = 0;
+
+    for (uint64_t i = 0; i < array_.size(); ++i) {
+      uint64_t w = array_[i];
+
+      for (uint32_t s = 1; s < Bits; s <<= 1) {
+        w |= w >> s;
+      }
+      ret += __builtin_popcountll(w & low);
+    }
+
+    return (ret);
+  }
+
+  // number of counters
+  uint64_t size() const {
+    return (len_);
+  }
+
+  // bytes used by the counters
+  uint64_t memory() const {
+    return (array_.size() * sizeof(uint64_t));
+  }
+
+  uint64_t words() const {
+    return (array_.size());
+  }
+
+  // true when the counters are read from a mapped file
+  bool mapped() const {
+    return (array_.mapped());
+  }
+
+  uint64_t *data() {
+    return (array_.data());
+  }
+
+  const uint64_t *data() const {
+    return (array_.data());
+  }
+
+protected:
+
+  static inline uint64_t word(const uint64_t index) {
+    return (index >> WORD_SHIFT);
+  }
+
+  static inline uint32_t shift(const uint64_t index) {
+    return ((uint32_t)(index & (PER_WORD - 1)) * Bits);
+  }
+
+  // lowest bit of every counter in a word
+  static uint64_t lane_low() {
+    uint64_t ret = 0;
+
+    for (uint32_t i = 0; i < PER_WORD; ++i) {
+      ret |= (uint64_t)1 << (i * Bits);
+    }
+
+    return (ret);
+  }
+
+  // Combine with o counter by counter. With AVX2 the counters at each
+  // offset within a byte are widened to bytes, combined with a saturating
+  // byte add (or byte min) clamped to MAX, and shifted back.
+  template <bool Add>
+  void merge(const PackedBloomArray<Bits> &o) {
+    uint64_t *dst = array_.data();
+    const uint64_t *src = o.array_.data();
+    const uint64_t n = array_.size();
+    uint64_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i max = _mm256_set1_epi8((char)MAX);
+    for (; i + 4 <= n; i += 4) {
+      const __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+      const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+      __m256i r = _mm256_setzero_si256();
+
+      for (uint32_t s = 0; s < 8; s += Bits) {
+        const __m256i la = _mm256_and_si256(_mm256_srli_epi64(a, s), max);
+        const __m256i lb = _mm256_and_si256(_mm256_srli_epi64(b, s), max);
+        const __m256i v = Add ? _mm256_min_epu8(_mm256_adds_epu8(la, lb), max) : _mm256_min_epu8(la, lb);
+
+        r = _mm256_or_si256(r, _mm256_slli_epi64(v, s));
+      }
+      _mm256_storeu_si256((__m256i *)(dst + i), r);
+    }
+#endif
+    for (; i < n; ++i) {
+      uint64_t r = 0;
+
+      for (uint32_t s = 0; s < 64; s += Bits) {
+        const uint64_t a = (dst[i] >> s) & MAX;
+        const uint64_t b = (src[i] >> s) & MAX;
+        const uint64_t v = Add ? (a + b > MAX ? MAX : a + b) : (a < b ? a : b);
+
+        r |= v << s;
+      }
+      dst[i] = r;
+    }
+  }
+
+  template <bool Inc>
+  void bulk(const uint64_t *indices, const uint64_t n) {
+    const uint64_t block = 32;
+    uint64_t words[block];
+    uint64_t shifts[block];
+
+    for (uint64_t b = 0; b < n; b += block) {
+      const uint64_t len = n - b < block ? n - b : block;
+      uint64_t j;
+
+      for (j = 0; j < len; ++j) {
+        words[j] = word(indices[b + j]);
+        shifts[j] = shift(indices[b + j]);
+      }
+
+      for (j = 0; j < len; ++j) {
+        __builtin_prefetch(&array_[words[j]]);
+      }
+
+      for (j = 0; j < len; ++j) {
+        uint64_t &w = array_[words[j]];
+        const uint64_t v = (w >> shifts[j]) & MAX;
+
+        if (Inc) {
+          w += (uint64_t)(v != MAX) << shifts[j];
+        } else {
+          w -= (uint64_t)(v != 0) << shifts[j];
+        }
+      }
+    }
+  }
+
+  BloomWords array_;
+  // user defined len
+  uint64_t len_;
+};
+
+// definitions of the class constants, for when they are bound to a
+// reference (std::min, etc.)
+template <uint32_t Bits>
+const uint64_t PackedBloomArray<Bits>::MAX;
+template <uint32_t Bits>
+const uint64_t PackedBloomArray<Bits>::PER_WORD;
+template <uint32_t Bits>
+const uint32_t PackedBloomArray<Bits>::WORD_SHIFT;
+
+
+
 #endif
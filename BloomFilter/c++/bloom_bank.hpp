@@ -0,0 +1,204 @@
+/*
+ * bloom_bank.hpp
+ *
+ *
+ * Bit-sliced Bloom Filter Bank Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __BLOOM_FILTER_BANK__
+#define __BLOOM_FILTER_BANK__
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// N Bloom filters of the same size and hashing, stored bit-sliced as in
+// BitFunnel ("BitFunnel: Revisiting Signatures for Search" by B. Goodwin
+// et al.): row i holds bit i of every filter, N bits side by side. Asking
+// which filters may hold a key reads and ANDs the key's k rows, instead 
+// of probing N separate filters, and yields a bitmap with bit j set when
+// filter j may hold the key.
+template <class S, class T>
+class BloomFilterBank {
+public:
+
+  // filters filters, each sized for expected_n keys at false positive
+  // rate fpp, with indices derived from one DoubleHash of the key
+  BloomFilterBank(const uint64_t filters, const uint64_t expected_n, const double fpp,
+                  const uint32_t seed = 0) :
+    filters_(filters),
+    // rows are padded to 256 bits for the AVX2 AND
+    row_words_(((filters + 255) >> 8) << 2),
+    len_(bloom_optimal_bits(expected_n, fpp)),
+    array_(len_ * row_words_, 0),
+    expected_n_(expected_n),
+    k_(bloom_optimal_hashes(len_, expected_n)),
+    seed_(seed)
+  {
+    assert(filters);
+  }
+
+  // add s to filter j
+  void add(const uint64_t j, const T &s) {
+    assert(j < filters_);
+    const DoubleHash h(s, seed_);
+    const uint64_t bit = (uint64_t)1 << (j & 63);
+
+    for (uint32_t i = 0; i < k_; ++i) {
+      row(fast_range(h[i], len_))[j >> 6] |= bit;
+    }
+  }
+
+  // true if filter j may hold s
+  bool exists(const uint64_t j, const T &s) const {
+    assert(j < filters_);
+    const DoubleHash h(s, seed_);
+
+    for (uint32_t i = 0; i < k_; ++i) {
+      if (!((row(fast_range(h[i], len_))[j >> 6] >> (j & 63)) & 1)) {
+        return (false);
+      }
+    }
+
+    return (true);
+  }
+
+  // Write to out (words_per_row() words) the bitmap of the filters that
+  // may hold s. Returns false if there are none.
+  bool query(const T &s, uint64_t *out) const {
+    const DoubleHash h(s, seed_);
+    const uint64_t *first = row(fast_range(h[0], len_));
+
+    std::copy(first, first + row_words_, out);
+    for (uint32_t i = 1; i < k_; ++i) {
+      bloom_and(out, row(fast_range(h[i], len_)), row_words_);
+    }
+
+    for (uint64_t w = 0; w < row_words_; ++w) {
+      if (out[w]) {
+        return (true);
+      }
+    }
+
+    return (false);
+  }
+
+  std::vector<uint64_t> query(const T &s) const {
+    std::vector<uint64_t> ret(row_words_);
+
+    query(s, &ret[0]);
+
+    return (ret);
+  }
+
+  // empty filter j
+  void clear(const uint64_t j) {
+    assert(j < filters_);
+    const uint64_t mask = ~((uint64_t)1 << (j & 63));
+
+    for (uint64_t i = 0; i < len_; ++i) {
+      row(i)[j >> 6] &= mask;
+    }
+  }
+
+  void clear() {
+    std::fill(array_.begin(), array_.end(), 0);
+  }
+
+  // number of filters
+  uint64_t filters() const {
+    return (filters_);
+  }
+
+  // number of bits in each filter
+  uint64_t size() const {
+    return (len_);
+  }
+
+  // length of a query() bitmap
+  uint64_t words_per_row() const {
+    return (row_words_);
+  }
+
+  uint32_t hashes() const {
+    return (k_);
+  }
+
+  // bytes used by all filters
+  uint64_t memory() const {
+    return (array_.size() * sizeof(uint64_t));
+  }
+
+  // false positive rate of each filter once expected_n items have been added
+  double expected_fpp() const {
+    return (bloom_fpp(len_, expected_n_, k_));
+  }
+
+private:
+
+  inline uint64_t *row(const uint64_t i) {
+    return (&array_[i * row_words_]);
+  }
+
+  inline const uint64_t *row(const uint64_t i) const {
+    return (&array_[i * row_words_]);
+  }
+
+  uint64_t filters_;
+  uint64_t row_words_;
+  uint64_t len_;
+  // len_ rows of row_words_ words
+  std::vector<uint64_t> array_;
+  uint64_t expected_n_;
+  uint32_t k_;
+  uint32_t seed_;
+};
+
+
+#endif
@@ -0,0 +1,503 @@
+/*
+ * bloom_bench.cpp
+ *
+ *
+ * Bloom Filter Benchmarks
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+
+#include "bloom.hpp"
+#include "bloom_bank.hpp"
+#include "blocked_bloom.hpp"
+#include "concurrent_bloom.hpp"
+#include "counting_bloom.hpp"
+#include "cuckoo_filter.hpp"
+#include "binary_fuse_filter.hpp"
+#include "MurmurHash3.hpp"
+
+
+static uint64_t splitmix(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return (z ^ (z >> 31));
+}
+
+template <uint64_t seed>
+uint64_t hash64(const uint64_t &x) {
+  uint64_t state = x ^ (seed * 0x2545f4914f6cdd1dULL);
+
+  return (splitmix(state));
+}
+
+class Timer {
+public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  double ns_per(const uint64_t ops) const {
+    std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start_;
+
+    return (d.count() / ops);
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+static void report(const std::string &name, const std::string &op, const double ns) {
+  std::cout << std::left << std::setw(24) << name << std::setw(10) << op
+            << std::fixed << std::setprecision(2) << ns << " ns/op" << std::endl;
+}
+
+// Time add() over keys, then exists() over a mix of present and absent keys
+template <class F, class K>
+void bench(const std::string &name, F &f, const std::vector<K> &keys,
+           const std::vector<K> &queries) {
+  uint64_t found = 0;
+
+  Timer add;
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    f.add(keys[i]);
+  }
+  report(name, "add", add.ns_per(keys.size()));
+
+  Timer query;
+  for (uint64_t i = 0; i < queries.size(); ++i) {
+    found += f.exists(queries[i]);
+  }
+  report(name, "exists", query.ns_per(queries.size()));
+
+  std::cout << std::left << std::setw(24) << name << std::setw(10) << "memory"
+            << f.memory() << " bytes, " << found << " hits" << std::endl;
+}
+
+
+void bench_blocked(const uint64_t n, const double fpp) {
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> queries(n);
+  uint64_t state = 42;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = splitmix(state);
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    queries[i] = (i & 1) ? keys[splitmix(state) % n] : splitmix(state);
+  }
+
+  BloomFilter<uint64_t, uint64_t> classic(n, fpp);
+  BloomFilter<uint64_t, uint64_t>::hash_function hashes[] = {
+    hash64<1>, hash64<2>, hash64<3>, hash64<4>, hash64<5>, hash64<6>, hash64<7>,
+    hash64<8>, hash64<9>, hash64<10>, hash64<11>, hash64<12>, hash64<13>, hash64<14>
+  };
+  for (uint32_t i = 0; i < classic.optimal_hashes() && i < 14; ++i) {
+    classic.addHash(hashes[i]);
+  }
+  bench("BloomFilter", classic, keys, queries);
+
+  BlockedBloomFilter<uint64_t, uint64_t> blocked(n, fpp, hash64<1>);
+  bench("BlockedBloomFilter", blocked, keys, queries);
+
+  // the same filter behind the type erased, virtual interface
+  AnyBloom<uint64_t, uint64_t> any(blocked);
+  const Bloom<uint64_t, uint64_t> &dynamic = any;
+  uint64_t found = 0;
+
+  Timer query;
+  for (uint64_t i = 0; i < queries.size(); ++i) {
+    found += dynamic.exists(queries[i]);
+  }
+  report("BlockedBloom (AnyBloom)", "exists", query.ns_per(queries.size()));
+  std::cout << std::left << std::setw(24) << "BlockedBloom (AnyBloom)" << std::setw(10) << "hits"
+            << found << std::endl;
+}
+
+
+template <uint32_t seed>
+uint64_t murmur64(const std::string &s) {
+  uint64_t out[2];
+  MurmurHash3_x64_128(s.data(), s.length(), seed, out);
+
+  return (out[0]);
+}
+
+// one hash pass per probe versus one 128 bit hash per key
+void bench_double_hash(const uint64_t n, const double fpp) {
+  std::vector<std::string> keys(n);
+  std::vector<std::string> queries(n);
+  uint64_t state = 7;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = std::string(128, 'x') + std::to_string(splitmix(state));
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    queries[i] = (i & 1) ? keys[splitmix(state) % n] : std::string(128, 'x') + std::to_string(splitmix(state));
+  }
+
+  BloomFilter<uint64_t, std::string> list(n, fpp);
+  BloomFilter<uint64_t, std::string>::hash_function hashes[] = {
+    murmur64<1>, murmur64<2>, murmur64<3>, murmur64<4>, murmur64<5>, murmur64<6>, murmur64<7>,
+    murmur64<8>, murmur64<9>, murmur64<10>, murmur64<11>, murmur64<12>, murmur64<13>, murmur64<14>
+  };
+  for (uint32_t i = 0; i < list.optimal_hashes() && i < 14; ++i) {
+    list.addHash(hashes[i]);
+  }
+  bench("BloomFilter (list)", list, keys, queries);
+
+  BloomFilter<uint64_t, std::string> km(n, fpp, 1u);
+  bench("BloomFilter (double)", km, keys, queries);
+}
+
+
+// the same filter fed one key at a time and in 4096 key batches
+void bench_batch(const uint64_t n, const double fpp) {
+  const uint64_t batch = 4096;
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> queries(n);
+  uint64_t state = 11;
+  uint64_t found = 0;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = splitmix(state);
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    queries[i] = (i & 1) ? keys[splitmix(state) % n] : splitmix(state);
+  }
+
+  BloomFilter<uint64_t, uint64_t> single(n, fpp, 1u);
+  bench("BloomFilter", single, keys, queries);
+
+  BloomFilter<uint64_t, uint64_t> batched(n, fpp, 1u);
+  Timer add;
+  for (uint64_t i = 0; i < n; i += batch) {
+    batched.add_batch(&keys[i], std::min(batch, n - i));
+  }
+  report("BloomFilter (batch)", "add", add.ns_per(n));
+
+  Timer query;
+  for (uint64_t i = 0; i < n; i += batch) {
+    std::vector<uint64_t> r = batched.exists_batch(&queries[i], std::min(batch, n - i));
+    for (uint64_t j = 0; j < r.size(); ++j) {
+      found += __builtin_popcountll(r[j]);
+    }
+  }
+  report("BloomFilter (batch)", "exists", query.ns_per(n));
+  std::cout << std::left << std::setw(24) << "BloomFilter (batch)" << std::setw(10) << "memory"
+            << batched.memory() << " bytes, " << found << " hits" << std::endl;
+}
+
+
+// aggregate add and exists throughput of one shared filter, 1..max_threads
+void bench_concurrent(const uint64_t n, const double fpp, const uint32_t max_threads) {
+  std::vector<uint64_t> keys(n);
+  uint64_t state = 13;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = splitmix(state);
+  }
+
+  for (uint32_t threads = 1; threads <= max_threads; ++threads) {
+    ConcurrentBloomFilter<uint64_t, uint64_t> f(n, fpp, 1u);
+    std::vector<std::thread> pool;
+    std::vector<uint64_t> found(threads, 0);
+    std::stringstream name;
+
+    name << "Concurrent (" << threads << " thr)";
+
+    Timer add;
+    for (uint32_t t = 0; t < threads; ++t) {
+      pool.push_back(std::thread([&f, &keys, t, threads, n]() {
+            for (uint64_t i = t; i < n; i += threads) {
+              f.add(keys[i]);
+            }
+          }));
+    }
+    for (uint32_t t = 0; t < threads; ++t) {
+      pool[t].join();
+    }
+    report(name.str(), "add", add.ns_per(n));
+
+    pool.clear();
+    Timer query;
+    for (uint32_t t = 0; t < threads; ++t) {
+      pool.push_back(std::thread([&f, &keys, &found, t, threads, n]() {
+            for (uint64_t i = t; i < n; i += threads) {
+              found[t] += f.exists(keys[i]);
+            }
+          }));
+    }
+    for (uint32_t t = 0; t < threads; ++t) {
+      pool[t].join();
+    }
+    report(name.str(), "exists", query.ns_per(n));
+  }
+}
+
+
+// deletable filters at equal false positive rate: a 12 bit cuckoo filter
+// at 95% load (~0.19%) against a 4 bit CountingBloomFilter sized for it
+void bench_cuckoo(const uint64_t n) {
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> queries(n);
+  uint64_t state = 17;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = splitmix(state);
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    queries[i] = (i & 1) ? keys[splitmix(state) % n] : splitmix(state);
+  }
+
+  CuckooFilter<uint64_t, uint64_t, 16> cuckoo(n, 1);
+  bench("CuckooFilter<16>", cuckoo, keys, queries);
+
+  const double fpp = cuckoo.expected_fpp();
+  const uint32_t k = bloom_optimal_hashes(bloom_optimal_bits(n, fpp), n);
+  CountingBloomFilter<uint64_t, uint64_t>::hash_function hashes[] = {
+    hash64<1>, hash64<2>, hash64<3>, hash64<4>, hash64<5>, hash64<6>, hash64<7>,
+    hash64<8>, hash64<9>, hash64<10>, hash64<11>, hash64<12>, hash64<13>, hash64<14>
+  };
+  std::vector<CountingBloomFilter<uint64_t, uint64_t>::hash_function> list;
+  for (uint32_t i = 0; i < k && i < 14; ++i) {
+    list.push_back(hashes[i]);
+  }
+  CountingBloomFilter<uint64_t, uint64_t> counting(n, fpp, list);
+  bench("CountingBloomFilter<4>", counting, keys, queries);
+
+  Timer remove_cuckoo;
+  for (uint64_t i = 0; i < n; ++i) {
+    cuckoo.remove(keys[i]);
+  }
+  report("CuckooFilter<16>", "remove", remove_cuckoo.ns_per(n));
+
+  Timer remove_counting;
+  for (uint64_t i = 0; i < n; ++i) {
+    counting.remove(keys[i]);
+  }
+  report("CountingBloomFilter<4>", "remove", remove_counting.ns_per(n));
+}
+
+
+// immutable key set: one add() at a time into a BloomFilter against a 
+// parallel binary fuse build
+void bench_binary_fuse(const uint64_t n, const uint32_t threads) {
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> queries(n);
+  uint64_t state = 19;
+  uint64_t found = 0;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = splitmix(state);
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    queries[i] = (i & 1) ? keys[splitmix(state) % n] : splitmix(state);
+  }
+
+  BloomFilter<uint64_t, uint64_t> bloom(n, 0.0039, 1u);
+  bench("BloomFilter", bloom, keys, queries);
+
+  BinaryFuseFilter<uint64_t> fuse;
+  Timer build;
+  fuse.build(keys, threads);
+  report("BinaryFuseFilter<8>", "build", build.ns_per(n));
+
+  Timer query;
+  for (uint64_t i = 0; i < n; ++i) {
+    found += fuse.exists(queries[i]);
+  }
+  report("BinaryFuseFilter<8>", "exists", query.ns_per(n));
+  std::cout << std::left << std::setw(24) << "BinaryFuseFilter<8>" << std::setw(10) << "memory"
+            << fuse.memory() << " bytes, " << found << " hits" << std::endl;
+}
+
+
+void bench_merge(const uint64_t n, const double fpp, const uint32_t shards) {
+  std::vector<BloomFilter<uint64_t, uint64_t> > parts(shards, BloomFilter<uint64_t, uint64_t>(n, fpp, 1u));
+  std::vector<const BloomFilter<uint64_t, uint64_t> *> ptrs;
+  uint64_t state = 23;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    parts[i % shards].add(splitmix(state));
+  }
+  for (uint32_t i = 0; i < shards; ++i) {
+    ptrs.push_back(&parts[i]);
+  }
+
+  BloomFilter<uint64_t, uint64_t> pairwise(n, fpp, 1u);
+  Timer one;
+  for (uint32_t i = 0; i < shards; ++i) {
+    pairwise.merge_union(parts[i]);
+  }
+  report("Bloom merge (pairwise)", "word", one.ns_per(pairwise.size() / 64 * shards));
+
+  BloomFilter<uint64_t, uint64_t> blocked(n, fpp, 1u);
+  Timer all;
+  blocked.merge_union(ptrs);
+  report("Bloom merge (blocked)", "word", all.ns_per(blocked.size() / 64 * shards));
+
+  Timer card;
+  const double estimate = blocked.estimate_cardinality();
+  report("Bloom cardinality", "word", card.ns_per(blocked.size() / 64));
+  std::cout << std::left << std::setw(24) << "Bloom cardinality" << std::setw(10) << "estimate"
+            << (uint64_t)estimate << " of " << n << std::endl;
+}
+
+void bench_file(const uint64_t n, const double fpp) {
+  const char *path = "bloom_bench.tmp";
+  std::vector<uint64_t> keys(n);
+  uint64_t state = 31;
+  uint64_t found = 0;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys[i] = splitmix(state);
+  }
+
+  Timer build;
+  BloomFilter<uint64_t, uint64_t> f(n, fpp, 1u);
+  for (uint64_t i = 0; i < n; ++i) {
+    f.add(keys[i]);
+  }
+  report("Bloom rebuild", "key", build.ns_per(n));
+
+  Timer save;
+  f.save(path);
+  report("Bloom save", "key", save.ns_per(n));
+
+  BloomFilter<uint64_t, uint64_t> g(1, 0.5, 1u);
+  Timer load;
+  g.load(path);
+  report("Bloom load (mapped)", "key", load.ns_per(n));
+
+  Timer verify;
+  g.load(path, true);
+  report("Bloom load (verified)", "key", verify.ns_per(n));
+
+  Timer query;
+  for (uint64_t i = 0; i < n; ++i) {
+    found += g.exists(keys[i]);
+  }
+  report("Bloom mapped", "exists", query.ns_per(n));
+  std::cout << std::left << std::setw(24) << "Bloom mapped" << std::setw(10) << "memory"
+            << g.memory() << " bytes, " << found << " hits" << std::endl;
+  remove(path);
+}
+
+void bench_bank(const uint64_t partitions, const uint64_t per, const double fpp) {
+  const uint64_t queries = 1000;
+  std::vector<BloomFilter<uint64_t, uint64_t> > separate(partitions, BloomFilter<uint64_t, uint64_t>(per, fpp, 1u));
+  BloomFilterBank<uint64_t, uint64_t> bank(partitions, per, fpp, 1u);
+  std::vector<uint64_t> keys(partitions * per);
+  std::vector<uint64_t> out(bank.words_per_row());
+  uint64_t state = 37;
+  uint64_t found = 0;
+
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    keys[i] = splitmix(state);
+    separate[i / per].add(keys[i]);
+    bank.add(i / per, keys[i]);
+  }
+
+  Timer loop;
+  for (uint64_t q = 0; q < queries; ++q) {
+    const uint64_t key = keys[q * (keys.size() / queries)];
+
+    for (uint64_t j = 0; j < partitions; ++j) {
+      found += separate[j].exists(key);
+    }
+  }
+  report("Bloom per partition", "query", loop.ns_per(queries));
+
+  Timer sliced;
+  for (uint64_t q = 0; q < queries; ++q) {
+    bank.query(keys[q * (keys.size() / queries)], &out[0]);
+    for (uint64_t w = 0; w < out.size(); ++w) {
+      found += __builtin_popcountll(out[w]);
+    }
+  }
+  report("Bloom bank", "query", sliced.ns_per(queries));
+  std::cout << std::left << std::setw(24) << "Bloom bank" << std::setw(10) << "memory"
+            << bank.memory() << " bytes, " << found << " hits" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const uint64_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+
+  std::cout << n << " keys, fpp 0.01" << std::endl;
+  bench_blocked(n, 0.01);
+
+  std::cout << std::endl << n / 10 << " 140 byte string keys, fpp 0.01" << std::endl;
+  bench_double_hash(n / 10, 0.01);
+
+  std::cout << std::endl << n << " keys, fpp 0.01, single vs batched" << std::endl;
+  bench_batch(n, 0.01);
+
+  const uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << std::endl << n << " keys, fpp 0.01, shared concurrent filter" << std::endl;
+  bench_concurrent(n, 0.01, cores);
+
+  std::cout << std::endl << n << " keys, deletable filters at equal fpp" << std::endl;
+  bench_cuckoo(n);
+
+  std::cout << std::endl << n << " keys, static set at fpp 0.0039" << std::endl;
+  bench_binary_fuse(n, cores);
+
+  std::cout << std::endl << n << " keys, fpp 0.01, merging 16 shards" << std::endl;
+  bench_merge(n, 0.01, 16);
+
+  std::cout << std::endl << n << " keys, fpp 0.01, saved and mapped back" << std::endl;
+  bench_file(n, 0.01);
+
+  std::cout << std::endl << "10000 partitions of 100 keys, fpp 0.01, which may hold a key" << std::endl;
+  bench_bank(10000, 100, 0.01);
+  
+  return (0);
+}
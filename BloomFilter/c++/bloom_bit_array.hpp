@@ -0,0 +1,280 @@
+/*
+ * bloom_bit_array.hpp
+ *
+ *
+ * Word Packed Bit Array and Bloom Filter Sizing
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __BLOOM_BIT_ARRAY__
+#define __BLOOM_BIT_ARRAY__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_file.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+// Number of keys the batched add/exists calls hash and prefetch before
+// touching the filter, i.e. how many keys have cache misses in flight
+const uint64_t BLOOM_BATCH_SIZE = 16;
+
+
+// Map a hash value uniformly onto [0, n) without a division. The hash is
+// left aligned in a 64 bit word, so narrow hash types work as well; when
+// n == 2^(bits in S) this is the identity.
+template <class S>
+inline uint64_t fast_range(const S &hash, const uint64_t n) {
+  const uint64_t h = (uint64_t)hash << (64 - (sizeof(S) << 3));
+
+  return ((uint64_t)(((unsigned __int128)h * n) >> 64));
+}
+
+// Number of bits needed to hold n items at false positive rate p
+inline uint64_t bloom_optimal_bits(const uint64_t n, const double p) {
+  assert(n);
+  assert(p > 0.0 && p < 1.0);
+
+  const double ln2 = std::log(2.0);
+
+  return ((uint64_t)std::ceil(-(double)n * std::log(p) / (ln2 * ln2)));
+}
+
+// Number of hash functions that minimizes the false positive rate
+// for m bits holding n items
+inline uint32_t bloom_optimal_hashes(const uint64_t m, const uint64_t n) {
+  assert(n);
+  
+  const uint32_t k = (uint32_t)std::floor((double)m / n * std::log(2.0) + 0.5);
+
+  return (k ? k : 1);
+}
+
+// Expected false positive rate of m bits holding n items with k hashes
+inline double bloom_fpp(const uint64_t m, const uint64_t n, const uint32_t k) {
+  return (std::pow(1.0 - std::exp(-(double)k * n / m), (double)k));
+}
+
+// Estimated number of distinct items in m bits with x bits set and k
+// hashes, from "Mathematical Correction for Fingerprint Similarity 
+// Measures to Improve Chemical Retrieval" by S. J. Swamidass and P. Baldi
+inline double bloom_cardinality(const uint64_t m, const uint64_t x, const uint32_t k) {
+  assert(k);
+  
+  if (x >= m) {
+    return (std::numeric_limits<double>::infinity());
+  }
+
+  return (-(double)m / k * std::log(1.0 - (double)x / m));
+}
+
+
+// Word-wise kernels over the backing arrays, used to merge filters built
+// in parallel. All of them stream through memory, 256 bits at a time
+// with AVX2.
+
+// dst[i] |= src[i]
+inline void bloom_or(uint64_t *dst, const uint64_t *src, const uint64_t n) {
+  uint64_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i < (n & ~(uint64_t)3); i += 4) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+    
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(a, b));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] |= src[i];
+  }
+}
+
+// dst[i] &= src[i]
+inline void bloom_and(uint64_t *dst, const uint64_t *src, const uint64_t n) {
+  uint64_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i < (n & ~(uint64_t)3); i += 4) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+    
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_and_si256(a, b));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] &= src[i];
+  }
+}
+
+// Number of set bits in src[0, n). The AVX2 path counts nibbles with a 
+// shuffle table ("Faster Population Counts Using AVX2 Instructions" by
+// W. Mula, N. Kurz and D. Lemire).
+inline uint64_t bloom_popcount(const uint64_t *src, const uint64_t n) {
+  uint64_t ret = 0;
+  uint64_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+
+  for (; i < (n & ~(uint64_t)3); i += 4) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+    const __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+    const __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+
+  ret = (uint64_t)_mm256_extract_epi64(acc, 0) + (uint64_t)_mm256_extract_epi64(acc, 1) +
+        (uint64_t)_mm256_extract_epi64(acc, 2) + (uint64_t)_mm256_extract_epi64(acc, 3);
+#endif
+  for (; i < n; ++i) {
+    ret += __builtin_popcountll(src[i]);
+  }
+
+  return (ret);
+}
+
+
+class BloomBitArray {
+public:
+
+  BloomBitArray(const uint64_t bits) :
+    array_(words_for(bits)),
+    len_(bits)
+  {
+    assert(bits);
+  }
+
+  // bits backed by words, e.g. a mapped file (see bloom_file.hpp)
+  BloomBitArray(const uint64_t bits, BloomWords words) :
+    array_(std::move(words)),
+    len_(bits)
+  {
+    assert(bits);
+    assert(array_.size() == words_for(bits));
+  }
+
+  // number of words needed for bits
+  static uint64_t words_for(const uint64_t bits) {
+    return ((bits + 63) >> 6);
+  }
+
+  inline void set(const uint64_t index) {
+    array_[index >> 6] |= (uint64_t)1 << (index & 63);
+  }
+
+  inline bool test(const uint64_t index) const {
+    return ((array_[index >> 6] >> (index & 63)) & 1);
+  }
+
+  inline void prefetch(const uint64_t index) const {
+    __builtin_prefetch(&array_[index >> 6]);
+  }
+
+  void clear() {
+    std::fill(array_.begin(), array_.end(), 0);
+  }
+
+  // set union/intersection with an array of the same size
+  void merge_or(const BloomBitArray &o) {
+    assert(len_ == o.len_);
+    bloom_or(array_.data(), o.array_.data(), array_.size());
+  }
+
+  void merge_and(const BloomBitArray &o) {
+    assert(len_ == o.len_);
+    bloom_and(array_.data(), o.array_.data(), array_.size());
+  }
+
+  // number of bits set
+  uint64_t popcount() const {
+    return (bloom_popcount(array_.data(), array_.size()));
+  }
+
+  // size in bits
+  uint64_t size() const {
+    return (len_);
+  }
+
+  // size of the backing store in bytes
+  uint64_t memory() const {
+    return (array_.size() * sizeof(uint64_t));
+  }
+
+  uint64_t words() const {
+    return (array_.size());
+  }
+
+  // true when the bits are read from a mapped file
+  bool mapped() const {
+    return (array_.mapped());
+  }
+
+  uint64_t *data() {
+    return (array_.data());
+  }
+
+  const uint64_t *data() const {
+    return (array_.data());
+  }
+
+protected:
+
+  BloomWords array_;
+  uint64_t len_;
+};
+
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * bloom_file.hpp
+ *
+ *
+ * On-disk Format for Bloom Filter Arrays
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __BLOOM_FILE__
+#define __BLOOM_FILE__
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../hash/MurmurHash3.hpp"
+
+
+// Backing store of the filter arrays: 64 bit words that are either owned
+// or a view into a mapped file. A copy always owns its words, so copies
+// of a mapped filter are independent of it and of each other.
+class BloomWords {
+public:
+
+  BloomWords(const uint64_t n = 0) :
+    own_(n, 0),
+    data_(own_.data()),
+    len_(n) {}
+
+  // view of n words at data, kept alive by map
+  BloomWords(const std::shared_ptr<void> &map, uint64_t *data, const uint64_t n) :
+    map_(map),
+    data_(data),
+    len_(n) {}
+
+  BloomWords(const BloomWords &o) :
+    own_(o.data_, o.data_ + o.len_),
+    data_(own_.data()),
+    len_(o.len_) {}
+
+  BloomWords(BloomWords &&o) :
+    own_(std::move(o.own_)),
+    map_(std::move(o.map_)),
+    data_(o.data_),
+    len_(o.len_)
+  {
+    o.data_ = NULL;
+    o.len_ = 0;
+  }
+
+  BloomWords &operator=(const BloomWords &o) {
+    if (this != &o) {
+      std::vector<uint64_t>(o.data_, o.data_ + o.len_).swap(own_);
+      map_.reset();
+      data_ = own_.data();
+      len_ = o.len_;
+    }
+
+    return (*this);
+  }
+
+  BloomWords &operator=(BloomWords &&o) {
+    if (this != &o) {
+      own_ = std::move(o.own_);
+      map_ = std::move(o.map_);
+      data_ = o.data_;
+      len_ = o.len_;
+      o.data_ = NULL;
+      o.len_ = 0;
+    }
+
+    return (*this);
+  }
+
+  inline uint64_t &operator[](const uint64_t i) {
+    return (data_[i]);
+  }
+
+  inline const uint64_t &operator[](const uint64_t i) const {
+    return (data_[i]);
+  }
+
+  uint64_t *begin() {
+    return (data_);
+  }
+
+  uint64_t *end() {
+    return (data_ + len_);
+  }
+
+  uint64_t *data() {
+    return (data_);
+  }
+
+  const uint64_t *data() const {
+    return (data_);
+  }
+
+  uint64_t size() const {
+    return (len_);
+  }
+
+  // true when the words live in a mapped file
+  bool mapped() const {
+    return ((bool)map_);
+  }
+
+private:
+
+  std::vector<uint64_t> own_;
+  std::shared_ptr<void> map_;
+  uint64_t *data_;
+  uint64_t len_;
+};
+
+
+// File layout, in host byte order: a 64 byte BloomFileHeader followed by
+// the words of the array. The header is checked on every open; the words
+// are only checksummed when asked to, so that opening is O(1).
+const char BLOOM_FILE_MAGIC[8] = "BLOOMFL";
+const uint32_t BLOOM_FILE_VERSION = 1;
+
+// BloomFileHeader::type
+const uint32_t BLOOM_FILE_BITS = 1;
+const uint32_t BLOOM_FILE_COUNTERS = 2;
+
+// BloomFileHeader::flags, set when indices come from DoubleHash
+const uint16_t BLOOM_FILE_DOUBLE_HASH = 1;
+
+struct BloomFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t type;
+  // number of bits or counters
+  uint64_t size;
+  uint64_t words;
+  uint64_t expected_n;
+  uint32_t hashes;
+  uint32_t seed;
+  uint16_t counter_bits;
+  uint16_t flags;
+  // MurmurHash3_x86_32 of the header with this field 0
+  uint32_t header_checksum;
+  // bloom_checksum of the words
+  uint64_t checksum;
+};
+
+static_assert(sizeof(BloomFileHeader) == 64, "BloomFileHeader must be 64 bytes");
+
+
+inline BloomFileHeader bloom_file_header(const uint32_t type, const uint16_t counter_bits,
+                                         const uint64_t size, const uint64_t words) {
+  BloomFileHeader ret;
+
+  memset(&ret, 0, sizeof(ret));
+  memcpy(ret.magic, BLOOM_FILE_MAGIC, sizeof(ret.magic));
+  ret.version = BLOOM_FILE_VERSION;
+  ret.type = type;
+  ret.counter_bits = counter_bits;
+  ret.size = size;
+  ret.words = words;
+
+  return (ret);
+}
+
+// MurmurHash3_x64_128 of n words, hashed in 1 MB chunks (its length is an
+// int) with each chunk seeded by the previous one
+inline uint64_t bloom_checksum(const uint64_t *words, const uint64_t n) {
+  const uint64_t chunk = 1 << 17;
+  uint64_t out[2] = {n, 0};
+
+  for (uint64_t i = 0; i < n; i += chunk) {
+    const uint64_t len = n - i < chunk ? n - i : chunk;
+
+    MurmurHash3_x64_128(words + i, (int)(len * sizeof(uint64_t)), (uint32_t)out[0], out);
+  }
+
+  return (out[0]);
+}
+
+inline uint32_t bloom_header_checksum(BloomFileHeader header) {
+  uint32_t ret;
+
+  header.header_checksum = 0;
+  MurmurHash3_x86_32(&header, sizeof(header), 0, &ret);
+
+  return (ret);
+}
+
+// Write header and words to path. The file is written next to path and
+// renamed over it, so readers (and filters mapping the old file) never
+// see a partial file. Returns false on any I/O error.
+inline bool bloom_file_save(const char *path, BloomFileHeader header, const uint64_t *words) {
+  const std::string tmp = std::string(path) + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "wb");
+
+  if (!fp) {
+    return (false);
+  }
+
+  header.checksum = bloom_checksum(words, header.words);
+  header.header_checksum = bloom_header_checksum(header);
+
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+  if (ok && header.words) {
+    ok = fwrite(words, sizeof(uint64_t), header.words, fp) == header.words;
+  }
+  ok = (fclose(fp) == 0) && ok;
+  ok = ok && rename(tmp.c_str(), path) == 0;
+  if (!ok) {
+    remove(tmp.c_str());
+  }
+
+  return (ok);
+}
+
+// Map the file at path and point words at its array, without reading it.
+// The mapping is private: the filter can still be modified, changed pages
+// are copied, and the file itself is never written. Returns false if the
+// file can't be mapped, the header is invalid, or verify is set and the
+// words don't match their checksum.
+inline bool bloom_file_open(const char *path, BloomFileHeader &header, BloomWords &words,
+                            const bool verify = false) {
+  struct stat st;
+  const int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return (false);
+  }
+  if (fstat(fd, &st) || st.st_size < (off_t)sizeof(header)) {
+    close(fd);
+    return (false);
+  }
+
+  const uint64_t len = st.st_size;
+  void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return (false);
+  }
+
+  uint64_t *array = (uint64_t *)((char *)p + sizeof(header));
+  memcpy(&header, p, sizeof(header));
+  if (memcmp(header.magic, BLOOM_FILE_MAGIC, sizeof(header.magic)) ||
+      header.version != BLOOM_FILE_VERSION ||
+      header.header_checksum != bloom_header_checksum(header) ||
+      len != sizeof(header) + header.words * sizeof(uint64_t) ||
+      (verify && header.checksum != bloom_checksum(array, header.words))) {
+    munmap(p, len);
+    return (false);
+  }
+  // filter probes are random, read ahead would only waste page cache
+  madvise(p, len, MADV_RANDOM);
+
+  words = BloomWords(std::shared_ptr<void>(p, [len](void *q) { munmap(q, len); }), 
+                     array, header.words);
+
+  return (true);
+}
+
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * concurrent_bloom.hpp
+ *
+ *
+ * Lock Free Concurrent Bloom Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __CONCURRENT_BLOOM_FILTER__
+#define __CONCURRENT_BLOOM_FILTER__
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// A BloomFilter that any number of threads may add to and query at the
+// same time without locks. Bits are only ever set, so each probe is a
+// single atomic fetch_or on the 64 bit word holding it (skipped when the
+// bit is already set, which keeps hot cache lines shared). All accesses
+// are relaxed: exists(s) sees s once the add(s) happens before it by some
+// other means (a join, a lock, etc.). A true exists() does not make other
+// writes of the adding thread visible, since an add() that finds all its
+// bits set writes nothing; publish those with your own synchronization.
+template <class S, class T>
+class ConcurrentBloomFilter : public StaticBloom<ConcurrentBloomFilter<S,T>, S, T> {
+public:
+  typedef S (*hash_function)(const T &s);
+
+  // Size the filter for expected_n items at a false positive rate of fpp,
+  // probing one index per function in hash_list.
+  ConcurrentBloomFilter(const uint64_t expected_n, const double fpp,
+                        const std::vector<hash_function> &hash_list) :
+    len_(bloom_optimal_bits(expected_n, fpp)),
+    words_((len_ + 63) >> 6),
+    array_(new std::atomic<uint64_t>[words_]),
+    hash_list_(hash_list),
+    expected_n_(expected_n),
+    k_(0),
+    seed_(0)
+  {
+    assert(hash_list_.size());
+    clear();
+  }
+
+  // Size the filter as above, deriving optimal_hashes() indices from a
+  // single 128 bit MurmurHash3 of the key (see double_hash.hpp).
+  ConcurrentBloomFilter(const uint64_t expected_n, const double fpp, const uint32_t seed) :
+    len_(bloom_optimal_bits(expected_n, fpp)),
+    words_((len_ + 63) >> 6),
+    array_(new std::atomic<uint64_t>[words_]),
+    expected_n_(expected_n),
+    k_(bloom_optimal_hashes(len_, expected_n)),
+    seed_(seed)
+  {
+    clear();
+  }
+
+  void add(const T &s) {
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      const uint64_t idx = index(s, h, i);
+      const uint64_t bit = (uint64_t)1 << (idx & 63);
+      std::atomic<uint64_t> &word = array_[idx >> 6];
+
+      if (!(word.load(std::memory_order_relaxed) & bit)) {
+        word.fetch_or(bit, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool exists(const T &s) const {
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      const uint64_t idx = index(s, h, i);
+
+      if (!((array_[idx >> 6].load(std::memory_order_relaxed) >> (idx & 63)) & 1)) {
+        return (false);
+      }
+    }
+
+    return (true);
+  }
+
+  // Not safe to call concurrently with add()
+  void clear() {
+    for (uint64_t i = 0; i < words_; ++i) {
+      array_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // number of bits in the filter
+  uint64_t size() const {
+    return (len_);
+  }
+
+  // bytes used by the bit array
+  uint64_t memory() const {
+    return (words_ * sizeof(uint64_t));
+  }
+
+  uint32_t optimal_hashes() const {
+    return (bloom_optimal_hashes(len_, expected_n_));
+  }
+
+  // number of indices probed per key
+  uint32_t hashes() const {
+    return (k_ ? k_ : (uint32_t)hash_list_.size());
+  }
+
+  // false positive rate once expected_n items have been added
+  double expected_fpp() const {
+    return (bloom_fpp(len_, expected_n_, hashes()));
+  }
+
+private:
+
+  ConcurrentBloomFilter(const ConcurrentBloomFilter<S,T> &);
+  ConcurrentBloomFilter<S,T> &operator=(const ConcurrentBloomFilter<S,T> &);
+
+  inline uint64_t index(const T &s, const DoubleHash &h, const uint32_t i) const {
+    if (k_) {
+      return (fast_range(h[i], len_));
+    }
+
+    return (fast_range((*hash_list_[i])(s), len_));
+  }
+
+  uint64_t len_;
+  uint64_t words_;
+  std::unique_ptr<std::atomic<uint64_t>[]> array_;
+  std::vector<hash_function> hash_list_;
+  uint64_t expected_n_;
+  // number of double hashed indices, 0 when hash_list_ is used
+  uint32_t k_;
+  uint32_t seed_;
+};
+
+
+#endif
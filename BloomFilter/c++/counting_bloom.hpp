@@ -49,54 +49,288 @@
 #ifndef __COUNTING_BLOOM_FILTER__
 #define __COUNTING_BLOOM_FILTER__
 
+#include <vector>
+#include <algorithm>
 #include <limits>
 #include <stdint.h>
 
 #include "bloom_.hpp"
 #include "bloom_array.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
 
 
-template <class S, class T>
-class CountingBloomFilter : Bloom<S, T> {
+// Counters are Bits wide (1, 2, 4 or 8), fixed at compile time. Both the
+// hash list and the hashes constructors still take the bits argument of
+// the runtime-width API, for compatibility; it must equal Bits (checked
+// with assert).
+template <class S, class T, uint32_t Bits = 4>
+class CountingBloomFilter : public StaticBloom<CountingBloomFilter<S,T,Bits>, S, T> {
 public:
   typedef S (*hash_function)(const T &s);
     
     
-  CountingBloomFilter(const std::vector<hash_function> &hash_list, uint32_t bits) : 
-    bloom_array_(std::numeric_limits<S>::max(), bits), 
-    hash_list_(hash_list) {}
+  CountingBloomFilter(const std::vector<hash_function> &hash_list, uint32_t bits = Bits) : 
+    bloom_array_(full_range()), 
+    hash_list_(hash_list),
+    expected_n_(0),
+    k_(0),
+    seed_(0)
+  {
+    assert(bits == Bits);
+  }
+
+  // Size the filter with one counter per bit of a BloomFilter holding
+  // expected_n items at a false positive rate of fpp. optimal_hashes()
+  // reports how many hash functions should be supplied.
+  CountingBloomFilter(const uint64_t expected_n, const double fpp, 
+                      const std::vector<hash_function> &hash_list) :
+    bloom_array_(bloom_optimal_bits(expected_n, fpp)),
+    hash_list_(hash_list),
+    expected_n_(expected_n),
+    k_(0),
+    seed_(0) {}
 
-  CountingBloomFilter(const CountingBloomFilter<S,T> &s) :
+  // Derive the indices of a key from a single 128 bit MurmurHash3 
+  // (see double_hash.hpp) rather than a list of hash functions
+  CountingBloomFilter(const uint32_t hashes, uint32_t bits = Bits, const uint32_t seed = 0) : 
+    bloom_array_(full_range()), 
+    expected_n_(0),
+    k_(hashes),
+    seed_(seed)
+  {
+    assert(hashes);
+    assert(bits == Bits);
+  }
+
+  CountingBloomFilter(const CountingBloomFilter<S,T,Bits> &s) :
     bloom_array_(s.bloom_array_),
-    hash_list_(s.hash_list_) {}
+    hash_list_(s.hash_list_),
+    expected_n_(s.expected_n_),
+    k_(s.k_),
+    seed_(s.seed_) {}
         
-  virtual void add(const T &s) {
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      bloom_array_.inc((*hash_list_[i])(s));
+  void add(const T &s) {
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      bloom_array_.inc(index(s, h, i));
     }
   }
 
-  virtual void remove(const T &s) {
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      bloom_array_.dec((*hash_list_[i])(s));
+  void remove(const T &s) {
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      bloom_array_.dec(index(s, h, i));
     }
   }
 
     
-  virtual bool exists(const T &s) const {
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      if (!bloom_array_.at((*hash_list_[i])(s))) {
+  bool exists(const T &s) const {
+    const DoubleHash h = k_ ? DoubleHash(s, seed_) : DoubleHash();
+
+    for (uint32_t i = 0; i < hashes(); ++i) {
+      if (!bloom_array_.at(index(s, h, i))) {
 	return (false);
       }
     }
     
     return (true);
   }
+
+  // Add keys[0, n), hashing and prefetching BLOOM_BATCH_SIZE keys at a time 
+  // before touching their counters. Bit i of the returned bitmap is set if
+  // keys[i] was already present.
+  std::vector<uint64_t> add_batch(const T *keys, const uint64_t n) {
+    std::vector<uint64_t> ret((n + 63) >> 6, 0);
+    std::vector<uint64_t> idx(BLOOM_BATCH_SIZE * hashes());
+    const uint32_t k = hashes();
+
+    for (uint64_t b = 0; b < n; b += BLOOM_BATCH_SIZE) {
+      const uint64_t len = std::min(BLOOM_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &idx[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        uint64_t present = 1;
+
+        for (uint32_t i = 0; i < k; ++i) {
+          present &= bloom_array_.at(idx[j * k + i]) != 0;
+          bloom_array_.inc(idx[j * k + i]);
+        }
+        ret[(b + j) >> 6] |= present << ((b + j) & 63);
+      }
+    }
+
+    return (ret);
+  }
+
+  // Test keys[0, n), as add_batch. Bit i of the returned bitmap is set if
+  // keys[i] may be present.
+  std::vector<uint64_t> exists_batch(const T *keys, const uint64_t n) const {
+    std::vector<uint64_t> ret((n + 63) >> 6, 0);
+    std::vector<uint64_t> idx(BLOOM_BATCH_SIZE * hashes());
+    const uint32_t k = hashes();
+
+    for (uint64_t b = 0; b < n; b += BLOOM_BATCH_SIZE) {
+      const uint64_t len = std::min(BLOOM_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &idx[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        uint64_t present = 1;
+
+        for (uint32_t i = 0; i < k; ++i) {
+          present &= bloom_array_.at(idx[j * k + i]) != 0;
+        }
+        ret[(b + j) >> 6] |= present << ((b + j) & 63);
+      }
+    }
+
+    return (ret);
+  }
+
+  // True when o has the same size and hashing, so counter i means the 
+  // same thing in both filters
+  bool compatible(const CountingBloomFilter<S,T,Bits> &o) const {
+    return (size() == o.size() && k_ == o.k_ && seed_ == o.seed_ && hash_list_ == o.hash_list_);
+  }
+
+  // Add every key of o, as many times as it was added to o (counter-wise
+  // saturating sum). Returns false, changing nothing, if the filters are 
+  // not compatible.
+  bool merge_union(const CountingBloomFilter<S,T,Bits> &o) {
+    if (!compatible(o)) {
+      return (false);
+    }
+    bloom_array_.merge_add(o.bloom_array_);
+
+    return (true);
+  }
+
+  // Counter-wise minimum: keys present in both, with the smaller count. 
+  // Returns false if the filters are not compatible.
+  bool intersect(const CountingBloomFilter<S,T,Bits> &o) {
+    if (!compatible(o)) {
+      return (false);
+    }
+    bloom_array_.merge_min(o.bloom_array_);
+
+    return (true);
+  }
+
+  // number of counters that are not 0
+  uint64_t popcount() const {
+    return (bloom_array_.nonzero());
+  }
+
+  // fraction of counters that are not 0
+  double fill_ratio() const {
+    return ((double)popcount() / size());
+  }
+
+  // estimated number of distinct keys present
+  double estimate_cardinality() const {
+    return (bloom_cardinality(size(), popcount(), hashes()));
+  }
+
+  // number of indices probed per key
+  uint32_t hashes() const {
+    return (k_ ? k_ : (uint32_t)hash_list_.size());
+  }
+
+  uint32_t optimal_hashes() const {
+    return (expected_n_ ? bloom_optimal_hashes(size(), expected_n_) : hashes());
+  }
+
+  // number of counters
+  uint64_t size() const {
+    return (bloom_array_.size());
+  }
+
+  // bytes used by the counters
+  uint64_t memory() const {
+    return (bloom_array_.memory());
+  }
+
+  // Write the filter to path (see bloom_file.hpp). Hash functions can't
+  // be saved: a filter using a hash_list must be loaded into one
+  // constructed with the same list.
+  bool save(const char *path) const {
+    BloomFileHeader h = bloom_file_header(BLOOM_FILE_COUNTERS, Bits, size(), bloom_array_.words());
+
+    h.expected_n = expected_n_;
+    h.hashes = hashes();
+    h.seed = seed_;
+    h.flags = k_ ? BLOOM_FILE_DOUBLE_HASH : 0;
+
+    return (bloom_file_save(path, h, bloom_array_.data()));
+  }
+
+  // Replace this filter with the one saved at path, mapped and queried in
+  // place as BloomFilter::load. Returns false, changing nothing, if the
+  // file is not a valid filter with Bits wide counters or needs a 
+  // different number of hash functions than hash_list holds.
+  bool load(const char *path, const bool verify = false) {
+    BloomFileHeader h;
+    BloomWords words;
+
+    if (!bloom_file_open(path, h, words, verify) || h.type != BLOOM_FILE_COUNTERS ||
+        h.counter_bits != Bits || !h.size || !h.hashes ||
+        h.words != PackedBloomArray<Bits>::words_for(h.size)) {
+      return (false);
+    }
+    if (!(h.flags & BLOOM_FILE_DOUBLE_HASH) && h.hashes != hash_list_.size()) {
+      return (false);
+    }
+
+    bloom_array_ = PackedBloomArray<Bits>(h.size, std::move(words));
+    expected_n_ = h.expected_n;
+    k_ = (h.flags & BLOOM_FILE_DOUBLE_HASH) ? h.hashes : 0;
+    seed_ = h.seed;
+
+    return (true);
+  }
+
+  // true when the filter is queried in place from a loaded file
+  bool mapped() const {
+    return (bloom_array_.mapped());
+  }
     
 protected:
+
+  static uint64_t full_range() {
+    assert(sizeof(S) < sizeof(uint64_t));
+    return ((uint64_t)std::numeric_limits<S>::max() + 1);
+  }
+
+  inline uint64_t index(const T &s, const DoubleHash &h, const uint32_t i) const {
+    if (k_) {
+      return (fast_range(h[i], bloom_array_.size()));
+    }
+
+    return (fast_range((*hash_list_[i])(s), bloom_array_.size()));
+  }
+
+  // compute and prefetch the hashes() indices of each of the n keys
+  void hash_batch(const T *keys, const uint64_t n, uint64_t *idx) const {
+    const uint32_t k = hashes();
+
+    for (uint64_t j = 0; j < n; ++j) {
+      const DoubleHash h = k_ ? DoubleHash(keys[j], seed_) : DoubleHash();
+
+      for (uint32_t i = 0; i < k; ++i) {
+        idx[j * k + i] = index(keys[j], h, i);
+        bloom_array_.prefetch(idx[j * k + i]);
+      }
+    }
+  }
   
-  BloomArray<> bloom_array_;
+  PackedBloomArray<Bits> bloom_array_;
   std::vector<hash_function> hash_list_;
+  uint64_t expected_n_;
+  // number of double hashed indices, 0 when hash_list_ is used
+  uint32_t k_;
+  uint32_t seed_;
 };
 
 
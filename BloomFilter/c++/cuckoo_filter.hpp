@@ -0,0 +1,324 @@
+/*
+ * cuckoo_filter.hpp
+ *
+ *
+ * Cuckoo Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __CUCKOO_FILTER__
+#define __CUCKOO_FILTER__
+
+#include <vector>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// Cuckoo filter, as introduced in "Cuckoo Filter: Practically Better Than
+// Bloom" by B. Fan, D. Andersen, M. Kaminsky and M. Mitzenmacher.
+//
+// Each bucket holds 4 fingerprints of Bits bits (4, 8 or 16), so that a
+// bucket is a 16, 32 or 64 bit lane of one word and never straddles two
+// words or cache lines. A key lives in one of two buckets:
+// i1 from its hash, and i2 = alt(i1, fp), where alt(i, fp) = (h(fp) - i)
+// mod buckets. alt() is its own inverse and only needs the fingerprint
+// (partial-key cuckoo hashing), so entries can be relocated without the 
+// original key, and the table size need not be a power of two. A lookup
+// reads the two candidate buckets.
+//
+// S only names the Bloom<S,T> interface; keys are hashed with MurmurHash3 
+// (see double_hash.hpp).
+template <class S, class T, uint32_t Bits = 16>
+class CuckooFilter : public StaticBloom<CuckooFilter<S,T,Bits>, S, T> {
+public:
+
+  static_assert(Bits == 4 || Bits == 8 || Bits == 16,
+                "fingerprints must be 4, 8 or 16 bits");
+
+  static const uint32_t SLOTS = 4;
+  static const uint32_t MAX_KICKS = 500;
+
+  // Size for expected_n keys at a load of max_load
+  CuckooFilter(const uint64_t expected_n, const uint32_t seed = 0, 
+               const double max_load = 0.95) :
+    buckets_((uint64_t)(expected_n / max_load) / SLOTS + 1),
+    array_((buckets_ * BUCKET_BITS + 63) / 64, 0),
+    count_(0),
+    overflows_(0),
+    victim_(0),
+    victim_index_(0),
+    seed_(seed),
+    rand_(seed ^ 0x9e3779b97f4a7c15ULL)
+  {
+    assert(max_load > 0.0 && max_load <= 1.0);
+  }
+
+  // Add s, returning false if the filter is full and s was not added
+  // (exists(s) may then be false). The table is full once an insert 
+  // runs out of kicks: the fingerprint left homeless is kept aside so 
+  // no key added so far is lost, but every later add() fails until a
+  // remove() makes room for it.
+  bool add(const T &s) {
+    uint64_t i;
+    uint32_t fp;
+    
+    locate(s, i, fp);
+    if (victim_) {
+      ++overflows_;
+      return (false);
+    }
+
+    if (put(i, fp) || put(alt(i, fp), fp)) {
+      ++count_;
+      return (true);
+    }
+
+    // evict a random resident, move it to its alternate bucket, repeat
+    i = (next_rand() & 1) ? i : alt(i, fp);
+    for (uint32_t n = 0; n < MAX_KICKS; ++n) {
+      const uint32_t slot = next_rand() & (SLOTS - 1);
+      const uint32_t evicted = get(i, slot);
+
+      set(i, slot, fp);
+      fp = evicted;
+      i = alt(i, fp);
+      if (put(i, fp)) {
+        ++count_;
+        return (true);
+      }
+    }
+
+    // keep the last homeless fingerprint so no key gives a false negative
+    victim_ = fp;
+    victim_index_ = i;
+    ++count_;
+
+    return (true);
+  }
+
+  void remove(const T &s) {
+    uint64_t i;
+    uint32_t fp;
+    
+    locate(s, i, fp);
+    const uint64_t i2 = alt(i, fp);
+    
+    if (erase(i, fp) || erase(i2, fp)) {
+      --count_;
+      // room for the victim now
+      if (victim_) {
+        const uint32_t v = victim_;
+        victim_ = 0;
+        --count_;
+        add_fingerprint(victim_index_, v);
+      }
+    } else if (victim_ == fp && (victim_index_ == i || victim_index_ == i2)) {
+      victim_ = 0;
+      --count_;
+    }
+  }
+
+  bool exists(const T &s) const {
+    uint64_t i;
+    uint32_t fp;
+    
+    locate(s, i, fp);
+    const uint64_t i2 = alt(i, fp);
+
+    return (contains(bucket(i), fp) | contains(bucket(i2), fp) |
+            (victim_ == fp && (victim_index_ == i || victim_index_ == i2)));
+  }
+
+  // stored fingerprints / slots
+  double load_factor() const {
+    return ((double)count_ / (buckets_ * SLOTS));
+  }
+
+  // Expected false positive rate at the current load: a lookup compares
+  // against up to 2 * SLOTS fingerprints of Bits bits
+  double expected_fpp() const {
+    return (2.0 * SLOTS * load_factor() / (((uint64_t)1 << Bits) - 1));
+  }
+
+  // number of fingerprint slots
+  uint64_t size() const {
+    return (buckets_ * SLOTS);
+  }
+
+  // bytes used by the table
+  uint64_t memory() const {
+    return (array_.size() * sizeof(uint64_t));
+  }
+
+  // adds that failed (returned false) because the table was full
+  uint64_t overflows() const {
+    return (overflows_);
+  }
+
+protected:
+
+  static const uint32_t BUCKET_BITS = SLOTS * Bits;
+  static const uint64_t FP_MASK = ((uint64_t)1 << Bits) - 1;
+  // lowest and highest bit of every fingerprint lane in a bucket
+  static const uint64_t LANE_LO = 1 | ((uint64_t)1 << Bits) | 
+                                  ((uint64_t)1 << (2 * Bits)) | ((uint64_t)1 << (3 * Bits));
+  static const uint64_t LANE_HI = LANE_LO << (Bits - 1);
+
+  void locate(const T &s, uint64_t &i, uint32_t &fp) const {
+    const DoubleHash h(s, seed_);
+    
+    i = fast_range(h.h1(), buckets_);
+    // 0 marks an empty slot
+    fp = (uint32_t)(h.h2() & FP_MASK);
+    fp += !fp;
+  }
+
+  inline uint64_t alt(const uint64_t i, const uint32_t fp) const {
+    const uint64_t h = fast_range((uint64_t)fp * 0x5bd1e9955bd1e995ULL, buckets_);
+
+    return (h >= i ? h - i : h + buckets_ - i);
+  }
+
+  // the whole bucket as one word; BUCKET_BITS divides 64
+  inline uint64_t bucket(const uint64_t i) const {
+    const uint64_t bit = i * BUCKET_BITS;
+    const uint64_t ret = array_[bit >> 6] >> (bit & 63);
+
+    return (BUCKET_BITS == 64 ? ret : ret & (((uint64_t)1 << (BUCKET_BITS & 63)) - 1));
+  }
+
+  // any lane of b equal to fp, without branching on the lanes
+  static inline bool contains(const uint64_t b, const uint32_t fp) {
+    const uint64_t x = b ^ (LANE_LO * fp);
+
+    return (((x - LANE_LO) & ~x & LANE_HI) != 0);
+  }
+
+  inline uint32_t get(const uint64_t i, const uint32_t slot) const {
+    return ((uint32_t)((bucket(i) >> (slot * Bits)) & FP_MASK));
+  }
+
+  inline void set(const uint64_t i, const uint32_t slot, const uint32_t fp) {
+    const uint64_t bit = i * BUCKET_BITS + slot * Bits;
+    const uint32_t off = bit & 63;
+    uint64_t &w = array_[bit >> 6];
+
+    w = (w & ~(FP_MASK << off)) | ((uint64_t)fp << off);
+  }
+
+  // store fp in a free slot of bucket i
+  bool put(const uint64_t i, const uint32_t fp) {
+    const uint64_t b = bucket(i);
+
+    for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+      if (!((b >> (slot * Bits)) & FP_MASK)) {
+        set(i, slot, fp);
+        return (true);
+      }
+    }
+
+    return (false);
+  }
+
+  // clear one copy of fp from bucket i
+  bool erase(const uint64_t i, const uint32_t fp) {
+    const uint64_t b = bucket(i);
+
+    for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+      if (((b >> (slot * Bits)) & FP_MASK) == fp) {
+        set(i, slot, 0);
+        return (true);
+      }
+    }
+
+    return (false);
+  }
+
+  // reinsert a fingerprint whose key is unknown, starting from bucket i
+  void add_fingerprint(uint64_t i, uint32_t fp) {
+    for (uint32_t n = 0; n <= MAX_KICKS; ++n) {
+      if (put(i, fp) || put(alt(i, fp), fp)) {
+        ++count_;
+        return;
+      }
+
+      i = alt(i, fp);
+      const uint32_t slot = next_rand() & (SLOTS - 1);
+      const uint32_t evicted = get(i, slot);
+
+      set(i, slot, fp);
+      fp = evicted;
+      i = alt(i, fp);
+    }
+
+    victim_ = fp;
+    victim_index_ = i;
+    ++count_;
+  }
+
+  inline uint32_t next_rand() {
+    rand_ ^= rand_ << 13;
+    rand_ ^= rand_ >> 7;
+    rand_ ^= rand_ << 17;
+
+    return ((uint32_t)rand_);
+  }
+
+  uint64_t buckets_;
+  std::vector<uint64_t> array_;
+  // stored fingerprints, including the victim
+  uint64_t count_;
+  uint64_t overflows_;
+  // fingerprint that could not be placed (0 if none) and one of its buckets
+  uint32_t victim_;
+  uint64_t victim_index_;
+  uint32_t seed_;
+  uint64_t rand_;
+};
+
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ * dleft_counting_bloom.hpp
+ *
+ *
+ * d-left Counting Bloom Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __DLEFT_COUNTING_BLOOM_FILTER__
+#define __DLEFT_COUNTING_BLOOM_FILTER__
+
+#include <vector>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// d-left counting Bloom filter, as introduced in "An Improved Construction 
+// for Counting Bloom Filters" by F. Bonomi, M. Mitzenmacher, R. Panigrahy,
+// S. Singh and G. Varghese.
+//
+// A key is reduced to a fingerprint f in [0, buckets * 2^r), and each of
+// the D sub-tables applies its own permutation of f to get a bucket and an
+// r bit remainder. The remainder is stored, with a 2 bit counter, in the 
+// least loaded of the D candidate buckets (leftmost on ties). Because the
+// permutations are invertible, a remainder found in a candidate bucket
+// always belongs to the same fingerprint, so remove() never drops another
+// key's entry. Each bucket is CELLS cells of type Cell, 16 bytes for the 
+// default uint16_t, so a lookup touches one cache line per sub-table.
+//
+// S only names the Bloom<S,T> interface; keys are hashed with MurmurHash3 
+// (see double_hash.hpp).
+template <class S, class T, class Cell = uint16_t>
+class DLeftCountingBloomFilter : public StaticBloom<DLeftCountingBloomFilter<S,T,Cell>, S, T> {
+public:
+
+  static const uint32_t D = 4;
+  static const uint32_t CELLS = 8;
+  static const uint32_t REMAINDER_BITS = sizeof(Cell) * 8 - 2;
+
+  // Size for expected_n keys at a load of max_load
+  DLeftCountingBloomFilter(const uint64_t expected_n, const uint32_t seed = 0, 
+                           const double max_load = 0.75) :
+    buckets_((uint64_t)(expected_n / max_load) / (D * CELLS) + 1),
+    range_(buckets_ << REMAINDER_BITS),
+    array_(D * buckets_ * CELLS, 0),
+    count_(0),
+    overflows_(0),
+    seed_(seed)
+  {
+    assert(max_load > 0.0 && max_load <= 1.0);
+
+    // multipliers coprime with range_ make f -> (a * f + b) mod range_ a
+    // permutation of the fingerprint space
+    const uint64_t salts[D] = { 0x9e3779b1ULL, 0x85ebca77ULL, 0xc2b2ae3dULL, 0x27d4eb2fULL };
+    for (uint32_t i = 0; i < D; ++i) {
+      mult_[i] = (salts[i] % range_) | 1;
+      while (gcd(mult_[i], range_) != 1) {
+        mult_[i] += 2;
+      }
+      add_[i] = salts[(i + 1) % D] % range_;
+    }
+  }
+
+  // Add s, returning false if all D of its candidate buckets are full,
+  // in which case s was not added (exists(s) may then be false) and 
+  // overflows() counts it. Adding a key already present only raises its
+  // counter, and always succeeds.
+  bool add(const T &s) {
+    uint64_t bucket[D];
+    Cell rem[D];
+    const uint64_t cell = find(s, bucket, rem);
+
+    if (cell != NOT_FOUND) {
+      // counters saturate and then stay put, as in CountingBloomFilter
+      array_[cell] += (array_[cell] & 3) != 3;
+      return (true);
+    }
+
+    // least loaded candidate, leftmost on ties
+    uint32_t best = D;
+    uint32_t best_load = CELLS;
+    for (uint32_t i = 0; i < D; ++i) {
+      const uint32_t l = load(i, bucket[i]);
+      if (l < best_load) {
+        best = i;
+        best_load = l;
+      }
+    }
+
+    if (best == D) {
+      ++overflows_;
+      return (false);
+    }
+
+    Cell *b = at(best, bucket[best]);
+    uint32_t j = 0;
+    while (j < CELLS && (b[j] & 3)) {
+      ++j;
+    }
+    // load() said there was a free cell; never write past the bucket
+    if (j == CELLS) {
+      ++overflows_;
+      return (false);
+    }
+    b[j] = (Cell)((rem[best] << 2) | 1);
+    ++count_;
+
+    return (true);
+  }
+
+  void remove(const T &s) {
+    uint64_t bucket[D];
+    Cell rem[D];
+    const uint64_t cell = find(s, bucket, rem);
+
+    if (cell == NOT_FOUND || (array_[cell] & 3) == 3) {
+      return;
+    }
+
+    if (!(--array_[cell] & 3)) {
+      array_[cell] = 0;
+      --count_;
+    }
+  }
+
+  bool exists(const T &s) const {
+    uint64_t bucket[D];
+    Cell rem[D];
+
+    return (find(s, bucket, rem) != NOT_FOUND);
+  }
+
+  // occupied cells / total cells
+  double load_factor() const {
+    return ((double)count_ / array_.size());
+  }
+
+  // Expected false positive rate at the current load: each of the D
+  // candidate buckets holds CELLS * load remainders of REMAINDER_BITS
+  double expected_fpp() const {
+    return (D * CELLS * load_factor() / ((uint64_t)1 << REMAINDER_BITS));
+  }
+
+  // number of cells
+  uint64_t size() const {
+    return (array_.size());
+  }
+
+  // bytes used by the sub-tables
+  uint64_t memory() const {
+    return (array_.size() * sizeof(Cell));
+  }
+
+  // adds that failed (returned false) because all D candidate buckets 
+  // were full
+  uint64_t overflows() const {
+    return (overflows_);
+  }
+
+protected:
+
+  static const uint64_t NOT_FOUND = ~(uint64_t)0;
+
+  static uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b) {
+      const uint64_t t = a % b;
+      a = b;
+      b = t;
+    }
+
+    return (a);
+  }
+
+  inline uint64_t offset(const uint32_t table, const uint64_t bucket) const {
+    return ((table * buckets_ + bucket) * CELLS);
+  }
+
+  inline Cell *at(const uint32_t table, const uint64_t bucket) {
+    return (&array_[offset(table, bucket)]);
+  }
+
+  inline const Cell *at(const uint32_t table, const uint64_t bucket) const {
+    return (&array_[offset(table, bucket)]);
+  }
+
+  inline uint32_t load(const uint32_t table, const uint64_t bucket) const {
+    const Cell *b = at(table, bucket);
+    uint32_t ret = 0;
+
+    for (uint32_t j = 0; j < CELLS; ++j) {
+      ret += (b[j] & 3) != 0;
+    }
+
+    return (ret);
+  }
+
+  // Compute the candidate bucket and remainder in every sub-table, and 
+  // return the offset of the cell holding the key's remainder, if any
+  uint64_t find(const T &s, uint64_t *bucket, Cell *rem) const {
+    const DoubleHash h(s, seed_);
+    const uint64_t f = fast_range(h.h1(), range_);
+
+    for (uint32_t i = 0; i < D; ++i) {
+      const uint64_t p = (uint64_t)(((unsigned __int128)mult_[i] * f + add_[i]) % range_);
+
+      bucket[i] = p >> REMAINDER_BITS;
+      rem[i] = (Cell)(p & (((uint64_t)1 << REMAINDER_BITS) - 1));
+      __builtin_prefetch(at(i, bucket[i]));
+    }
+
+    for (uint32_t i = 0; i < D; ++i) {
+      const Cell *b = at(i, bucket[i]);
+
+      for (uint32_t j = 0; j < CELLS; ++j) {
+        if ((b[j] & 3) && (Cell)(b[j] >> 2) == rem[i]) {
+          return (offset(i, bucket[i]) + j);
+        }
+      }
+    }
+
+    return (NOT_FOUND);
+  }
+
+  // buckets per sub-table
+  uint64_t buckets_;
+  // size of the fingerprint space, buckets_ * 2^REMAINDER_BITS
+  uint64_t range_;
+  std::vector<Cell> array_;
+  uint64_t mult_[D];
+  uint64_t add_[D];
+  // occupied cells
+  uint64_t count_;
+  uint64_t overflows_;
+  uint32_t seed_;
+};
+
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * fixed_bloom.hpp
+ *
+ *
+ * Fixed Size Bloom Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __FIXED_BLOOM_FILTER__
+#define __FIXED_BLOOM_FILTER__
+
+#include <array>
+#include <cmath>
+#include <stdint.h>
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// Default hasher for FixedBloom: the low 64 bits of MurmurHash3_x64_128
+// (see murmur_128 in double_hash.hpp for key types it can hash)
+struct FixedBloomHash {
+  template <class T>
+  uint64_t operator()(const T &key) const {
+    uint64_t out[2];
+
+    murmur_128(key, 0, out);
+
+    return (out[0]);
+  }
+};
+
+
+// A Bloom filter of Bits bits and K hashes fixed at compile time, stored
+// inline in a std::array. It never allocates, is trivially copyable (so 
+// it can be embedded in other structs and memcpy'd), and every index
+// computation uses constants. Meant for many small filters, e.g. one
+// per connection.
+//
+// Hasher is a default constructible type with a const operator() that 
+// maps a key to 64 bits. The K indices are derived from its two 32 bit
+// halves by double hashing, so Bits must be at most 2^32. Keys may be of
+// any type the Hasher takes, so the key type of StaticBloom is unused.
+template <uint64_t Bits, uint32_t K, class Hasher = FixedBloomHash>
+class FixedBloom : public StaticBloom<FixedBloom<Bits, K, Hasher>, uint64_t, void> {
+public:
+
+  static_assert(Bits && Bits <= ((uint64_t)1 << 32), "Bits must be in [1, 2^32]");
+  static_assert(K, "K must be at least 1");
+
+  static const uint64_t WORDS = (Bits + 63) >> 6;
+
+  FixedBloom() : array_() {}
+
+  template <class T>
+  void add(const T &s) {
+    const uint64_t h = Hasher()(s);
+
+    for (uint32_t i = 0; i < K; ++i) {
+      const uint64_t idx = index(h, i);
+
+      array_[idx >> 6] |= (uint64_t)1 << (idx & 63);
+    }
+  }
+
+  template <class T>
+  bool exists(const T &s) const {
+    const uint64_t h = Hasher()(s);
+
+    for (uint32_t i = 0; i < K; ++i) {
+      const uint64_t idx = index(h, i);
+
+      if (!((array_[idx >> 6] >> (idx & 63)) & 1)) {
+        return (false);
+      }
+    }
+
+    return (true);
+  }
+
+  void clear() {
+    array_.fill(0);
+  }
+
+  // add every key of o. The trip count is a constant, so the compiler
+  // unrolls and vectorizes this on its own.
+  void merge_union(const FixedBloom<Bits, K, Hasher> &o) {
+    for (uint64_t i = 0; i < WORDS; ++i) {
+      array_[i] |= o.array_[i];
+    }
+  }
+
+  // number of bits set
+  uint64_t popcount() const {
+    uint64_t ret = 0;
+
+    for (uint64_t i = 0; i < WORDS; ++i) {
+      ret += __builtin_popcountll(array_[i]);
+    }
+
+    return (ret);
+  }
+
+  // number of bits in the filter
+  static constexpr uint64_t size() {
+    return (Bits);
+  }
+
+  static constexpr uint32_t hashes() {
+    return (K);
+  }
+
+  // bytes used by the bit array
+  static constexpr uint64_t memory() {
+    return (WORDS * sizeof(uint64_t));
+  }
+
+  // false positive rate once n items have been added
+  static double expected_fpp(const uint64_t n) {
+    return (bloom_fpp(Bits, n, K));
+  }
+
+private:
+
+  // i-th index: h1 + i * h2 over 32 bits, mapped onto [0, Bits) with a
+  // multiply-shift (a mask when Bits is a power of 2)
+  static inline uint64_t index(const uint64_t h, const uint32_t i) {
+    // the largest 32 bit value maps to the last bit, up to Bits = 2^32
+    static_assert(range(0xffffffff) == Bits - 1, "indices must cover [0, Bits)");
+
+    return (range((uint32_t)h + i * ((uint32_t)(h >> 32) | 1)));
+  }
+
+  static constexpr uint64_t range(const uint32_t v) {
+    return ((Bits & (Bits - 1)) == 0 ? v & (Bits - 1) : ((uint64_t)v * Bits) >> 32);
+  }
+
+  std::array<uint64_t, WORDS> array_;
+};
+
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * generational_bloom.hpp
+ *
+ *
+ * Sliding Window (Generational) Bloom Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __GENERATIONAL_BLOOM_FILTER__
+#define __GENERATIONAL_BLOOM_FILTER__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// A Bloom filter over a sliding window of time. Time is split into
+// generations span units long (the unit is the caller's: seconds, event
+// ids, ...), and a key added during one is remembered for the next 
+// generations - 1 generations after it, so the window is between 
+// (generations - 1) * span and generations * span long.
+//
+// There is one sub-filter per live generation plus one spare, at most 8
+// in all, stored bit-sliced: each bit position is a slice of generations
+// + 1 bits holding that bit of every sub-filter, packed 64 / (generations
+// + 1) to a word. A probe is one word load, and a query ANDs k slices and
+// masks out the spare, so it tests every generation at once.
+// 
+// advance(now) moves to the generation holding now, which makes the
+// spare the current sub-filter and retires the oldest live one as the new
+// spare. The retired sub-filter is cleared a few words per add() rather 
+// than at once, so rotating never stalls inserts (what is left when the
+// next advance() comes is cleared then).
+template <class S, class T>
+class GenerationalBloomFilter : public StaticBloom<GenerationalBloomFilter<S,T>, S, T> {
+public:
+
+  // Size each generation for per_generation_n keys, so that a key in none
+  // of them is reported with probability fpp. now is the start time.
+  GenerationalBloomFilter(const uint64_t per_generation_n, const double fpp, 
+                          const uint32_t generations, const uint64_t span,
+                          const uint64_t now = 0, const uint32_t seed = 0) :
+    slots_(generations + 1),
+    lanes_(64 / slots_),
+    array_((bloom_optimal_bits(per_generation_n, fpp / generations) + lanes_ - 1) / lanes_, 0),
+    len_(array_.size() * lanes_),
+    lane_low_(lane_low(slots_, lanes_)),
+    span_(span),
+    generation_(now / span),
+    cursor_(array_.size()),
+    step_(array_.size() / per_generation_n + 1),
+    k_(bloom_optimal_hashes(len_, per_generation_n)),
+    seed_(seed)
+  {
+    assert(generations && generations < 8);
+    assert(span);
+  }
+
+  void add(const T &s) {
+    const DoubleHash h(s, seed_);
+    const uint64_t bit = (uint64_t)1 << current();
+
+    for (uint32_t i = 0; i < k_; ++i) {
+      array_[word(h[i])] |= bit << shift(h[i]);
+    }
+    clear_spare(step_);
+  }
+
+  // true if s may have been added in a live generation
+  bool exists(const T &s) const {
+    const DoubleHash h(s, seed_);
+    uint64_t live = live_mask();
+
+    for (uint32_t i = 0; i < k_ && live; ++i) {
+      live &= array_[word(h[i])] >> shift(h[i]);
+    }
+
+    return (live != 0);
+  }
+
+  // Move to the generation holding now, expiring the keys of generations
+  // that fell out of the window. Times before the current generation are
+  // ignored.
+  void advance(const uint64_t now) {
+    const uint64_t g = now / span_;
+
+    if (g <= generation_) {
+      return;
+    }
+    if (g - generation_ >= slots_) {
+      std::fill(array_.begin(), array_.end(), 0);
+      cursor_ = array_.size();
+      generation_ = g;
+      return;
+    }
+    while (generation_ < g) {
+      clear_spare(array_.size());
+      ++generation_;
+      cursor_ = 0;
+    }
+  }
+
+  void clear() {
+    std::fill(array_.begin(), array_.end(), 0);
+    cursor_ = array_.size();
+  }
+
+  // index of the current generation, i.e. the last now / span
+  uint64_t generation() const {
+    return (generation_);
+  }
+
+  // number of live generations
+  uint32_t generations() const {
+    return (slots_ - 1);
+  }
+
+  // number of bit positions in each generation
+  uint64_t size() const {
+    return (len_);
+  }
+
+  // bytes used by all generations
+  uint64_t memory() const {
+    return (array_.size() * sizeof(uint64_t));
+  }
+
+  uint32_t hashes() const {
+    return (k_);
+  }
+
+  // false positive rate once every live generation holds per_generation_n keys
+  double expected_fpp(const uint64_t per_generation_n) const {
+    return (1.0 - std::pow(1.0 - bloom_fpp(len_, per_generation_n, k_), (double)generations()));
+  }
+
+private:
+
+  // A position is a word, from the high bits of the hash, and a slice in
+  // it, from the low 32 bits, each mapped with a multiply-shift
+  inline uint64_t word(const uint64_t h) const {
+    return (fast_range(h, array_.size()));
+  }
+
+  inline uint32_t shift(const uint64_t h) const {
+    return ((uint32_t)(((h & 0xffffffffULL) * lanes_) >> 32) * slots_);
+  }
+
+  // lowest bit of every slice in a word
+  static uint64_t lane_low(const uint32_t slots, const uint32_t lanes) {
+    uint64_t ret = 0;
+
+    for (uint32_t i = 0; i < lanes; ++i) {
+      ret |= (uint64_t)1 << (i * slots);
+    }
+
+    return (ret);
+  }
+
+  // sub-filter of the current generation
+  uint32_t current() const {
+    return ((uint32_t)(generation_ % slots_));
+  }
+
+  // sub-filter of the next generation, which is being cleared
+  uint32_t spare() const {
+    return ((uint32_t)((generation_ + 1) % slots_));
+  }
+
+  // bit of every sub-filter but the spare
+  uint64_t live_mask() const {
+    return ((((uint64_t)1 << slots_) - 1) & ~((uint64_t)1 << spare()));
+  }
+
+  // clear up to n more words of the spare sub-filter
+  void clear_spare(const uint64_t n) {
+    const uint64_t mask = ~(lane_low_ << spare());
+    const uint64_t end = std::min<uint64_t>(array_.size(), cursor_ + n);
+
+    for (; cursor_ < end; ++cursor_) {
+      array_[cursor_] &= mask;
+    }
+  }
+
+  // sub-filters, the bits of each slice
+  uint32_t slots_;
+  // slices per word
+  uint32_t lanes_;
+  // slice i of a word holds bits i * slots_ to (i + 1) * slots_ - 1
+  std::vector<uint64_t> array_;
+  // bit positions of each sub-filter
+  uint64_t len_;
+  uint64_t lane_low_;
+  uint64_t span_;
+  uint64_t generation_;
+  // words of the spare below cursor_ are clear
+  uint64_t cursor_;
+  // words cleared per add()
+  uint64_t step_;
+  uint32_t k_;
+  uint32_t seed_;
+};
+
+
+#endif
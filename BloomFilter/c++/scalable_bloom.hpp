@@ -0,0 +1,238 @@
+/*
+ * scalable_bloom.hpp
+ *
+ *
+ * Scalable Bloom Filter Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __SCALABLE_BLOOM_FILTER__
+#define __SCALABLE_BLOOM_FILTER__
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <stdint.h>
+
+#include "bloom_.hpp"
+#include "bloom_bit_array.hpp"
+#include "../../hash/double_hash.hpp"
+
+
+// A Bloom filter for an unknown number of keys, from "Scalable Bloom 
+// Filters" by P. S. Almeida, C. Baquero, N. Preguica and D. Hutchison.
+// Keys go into the newest of a chain of stages. When it holds as many
+// keys as it was sized for, a new stage growth times larger is added, 
+// sized for tightening times the false positive rate of the one before.
+// The first stage gets fpp * (1 - tightening), so the rates form a 
+// geometric series and the overall rate stays below fpp however many 
+// stages are added, while memory follows the number of keys seen.
+//
+// All stages probe indices derived from one DoubleHash of the key.
+template <class S, class T>
+class ScalableBloomFilter : public StaticBloom<ScalableBloomFilter<S,T>, S, T> {
+public:
+
+  ScalableBloomFilter(const uint64_t initial_n, const double fpp, const uint32_t seed = 0,
+                      const double growth = 2.0, const double tightening = 0.85) :
+    fpp_(fpp),
+    growth_(growth),
+    tightening_(tightening),
+    seed_(seed)
+  {
+    assert(initial_n);
+    assert(fpp > 0.0 && fpp < 1.0);
+    assert(growth >= 1.0);
+    assert(tightening > 0.0 && tightening < 1.0);
+    stages_.push_back(Stage(initial_n, fpp * (1.0 - tightening)));
+  }
+
+  // Keys already present in the newest stage are not counted towards its
+  // capacity, so repeated keys don't make the filter grow.
+  void add(const T &s) {
+    if (stages_.back().count >= stages_.back().capacity) {
+      const Stage &last = stages_.back();
+
+      stages_.push_back(Stage((uint64_t)std::ceil(last.capacity * growth_), last.fpp * tightening_));
+    }
+
+    Stage &st = stages_.back();
+    const DoubleHash h(s, seed_);
+    const uint64_t bits = st.bits.size();
+    uint64_t present = 1;
+
+    for (uint32_t i = 0; i < st.k; ++i) {
+      const uint64_t idx = fast_range(h[i], bits);
+
+      present &= st.bits.test(idx);
+      st.bits.set(idx);
+    }
+    st.count += present ^ 1;
+  }
+
+  // Newest stage first: it is the largest and most likely to hold a key
+  // that was added recently.
+  bool exists(const T &s) const {
+    const DoubleHash h(s, seed_);
+
+    for (uint64_t j = stages_.size(); j-- > 0;) {
+      if (test(stages_[j], h)) {
+        return (true);
+      }
+    }
+
+    return (false);
+  }
+
+  // drop every stage but the first, and empty it
+  void clear() {
+    stages_.erase(stages_.begin() + 1, stages_.end());
+    stages_[0].bits.clear();
+    stages_[0].count = 0;
+  }
+
+  uint64_t stages() const {
+    return (stages_.size());
+  }
+
+  // number of bits in stage i
+  uint64_t stage_size(const uint64_t i) const {
+    return (stages_[i].bits.size());
+  }
+
+  // number of keys stage i was sized for
+  uint64_t stage_capacity(const uint64_t i) const {
+    return (stages_[i].capacity);
+  }
+
+  // number of keys added to stage i
+  uint64_t stage_count(const uint64_t i) const {
+    return (stages_[i].count);
+  }
+
+  // number of indices stage i probes per key
+  uint32_t stage_hashes(const uint64_t i) const {
+    return (stages_[i].k);
+  }
+
+  // fraction of bits set in stage i
+  double stage_fill(const uint64_t i) const {
+    return ((double)stages_[i].bits.popcount() / stages_[i].bits.size());
+  }
+
+  // number of keys added, over all stages
+  uint64_t count() const {
+    uint64_t ret = 0;
+
+    for (uint64_t i = 0; i < stages_.size(); ++i) {
+      ret += stages_[i].count;
+    }
+
+    return (ret);
+  }
+
+  // bytes used by all stages
+  uint64_t memory() const {
+    uint64_t ret = 0;
+
+    for (uint64_t i = 0; i < stages_.size(); ++i) {
+      ret += stages_[i].bits.memory();
+    }
+
+    return (ret);
+  }
+
+  // false positive rate with the keys added so far
+  double expected_fpp() const {
+    double none = 1.0;
+
+    for (uint64_t i = 0; i < stages_.size(); ++i) {
+      none *= 1.0 - bloom_fpp(stages_[i].bits.size(), stages_[i].count, stages_[i].k);
+    }
+
+    return (1.0 - none);
+  }
+
+  // bound on expected_fpp(), the rate given to the constructor
+  double max_fpp() const {
+    return (fpp_);
+  }
+
+private:
+
+  struct Stage {
+    Stage(const uint64_t n, const double p) :
+      bits(bloom_optimal_bits(n, p)),
+      capacity(n),
+      count(0),
+      fpp(p),
+      k(bloom_optimal_hashes(bits.size(), n)) {}
+
+    BloomBitArray bits;
+    uint64_t capacity;
+    uint64_t count;
+    double fpp;
+    uint32_t k;
+  };
+
+  static bool test(const Stage &st, const DoubleHash &h) {
+    const uint64_t bits = st.bits.size();
+
+    for (uint32_t i = 0; i < st.k; ++i) {
+      if (!st.bits.test(fast_range(h[i], bits))) {
+        return (false);
+      }
+    }
+
+    return (true);
+  }
+
+  std::vector<Stage> stages_;
+  double fpp_;
+  double growth_;
+  double tightening_;
+  uint32_t seed_;
+};
+
+
+#endif
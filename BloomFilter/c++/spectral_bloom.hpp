@@ -49,32 +49,38 @@
 #ifndef __SPECTRAL_BLOOM_FILTER__
 #define __SPECTRAL_BLOOM_FILTER__
 
+#include <vector>
+#include <algorithm>
 #include <limits>
 #include <stdint.h>
 
 #include "counting_bloom.hpp"
 
 
-template <class S, class T>
-class SpectralBloomFilter : public CountingBloomFilter<S, T> {
+template <class S, class T, uint32_t Bits = 4>
+class SpectralBloomFilter : public CountingBloomFilter<S, T, Bits> {
 public:
   typedef S (*hash_function)(const T &s);
     
     
-  SpectralBloomFilter(const std::vector<hash_function> &hash_list, uint32_t bits) : 
-    CountingBloomFilter<S,T>(hash_list, bits) {}
+  SpectralBloomFilter(const std::vector<hash_function> &hash_list, uint32_t bits = Bits) : 
+    CountingBloomFilter<S,T,Bits>(hash_list, bits) {}
 
-  SpectralBloomFilter(const CountingBloomFilter<S,T> &s) : 
-    CountingBloomFilter<S,T>(s) {}
+  SpectralBloomFilter(const uint32_t hashes, uint32_t bits = Bits, const uint32_t seed = 0) : 
+    CountingBloomFilter<S,T,Bits>(hashes, bits, seed) {}
+
+  SpectralBloomFilter(const CountingBloomFilter<S,T,Bits> &s) : 
+    CountingBloomFilter<S,T,Bits>(s) {}
         
   
   uint64_t occurrences(const T &s) const {
     
     uint64_t return_val = std::numeric_limits<uint64_t>::max();
     uint64_t compare_val;
+    const DoubleHash h = parent::k_ ? DoubleHash(s, parent::seed_) : DoubleHash();
     
-    for (uint32_t i = 0; i < parent::hash_list_.size(); ++i) {
-      compare_val = parent::bloom_array_.at((*parent::hash_list_[i])(s));
+    for (uint32_t i = 0; i < parent::hashes(); ++i) {
+      compare_val = parent::bloom_array_.at(parent::index(s, h, i));
       if (compare_val < return_val) {
 	return_val = compare_val;
       }
@@ -83,8 +89,29 @@ public:
     return (return_val);
   }
 
+  // occurrences() of keys[0, n), with the counters of BLOOM_BATCH_SIZE keys
+  // prefetched at a time (see CountingBloomFilter::add_batch)
+  std::vector<uint64_t> occurrences_batch(const T *keys, const uint64_t n) const {
+    std::vector<uint64_t> ret(n, std::numeric_limits<uint64_t>::max());
+    std::vector<uint64_t> idx(BLOOM_BATCH_SIZE * parent::hashes());
+    const uint32_t k = parent::hashes();
+
+    for (uint64_t b = 0; b < n; b += BLOOM_BATCH_SIZE) {
+      const uint64_t len = std::min(BLOOM_BATCH_SIZE, n - b);
+
+      parent::hash_batch(keys + b, len, &idx[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        for (uint32_t i = 0; i < k; ++i) {
+          ret[b + j] = std::min(ret[b + j], (uint64_t)parent::bloom_array_.at(idx[j * k + i]));
+        }
+      }
+    }
+
+    return (ret);
+  }
+
 private:
-  typedef CountingBloomFilter<S,T> parent;
+  typedef CountingBloomFilter<S,T,Bits> parent;
 
 };
 
@@ -0,0 +1,999 @@
+/*
+ * bloom_test.cpp
+ *
+ *
+ * Bloom Filter Test Program
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <cstring>
+#include <type_traits>
+
+#include "../bloom.hpp"
+#include "../blocked_bloom.hpp"
+#include "../concurrent_bloom.hpp"
+#include "../dleft_counting_bloom.hpp"
+#include "../cuckoo_filter.hpp"
+#include "../binary_fuse_filter.hpp"
+#include "../counting_bloom.hpp"
+#include "../spectral_bloom.hpp"
+#include "../scalable_bloom.hpp"
+#include "../generational_bloom.hpp"
+#include "../fixed_bloom.hpp"
+#include "../bloom_bank.hpp"
+#include "../../../hash/MurmurHash3.hpp"
+
+
+#define CHECK(x)                                                        \
+  if (!(x)) {                                                           \
+    std::cout << __FILE__ << ":" << __LINE__ << " check failed: " #x << std::endl; \
+    exit(1);                                                            \
+  }
+
+
+template <uint32_t seed>
+uint32_t hash32(const std::string &s) {
+  uint32_t ret;
+  MurmurHash3_x86_32(s.c_str(), s.length(), seed, &ret);
+  
+  return (ret);
+}
+
+std::string key(const uint64_t i) {
+  std::stringstream ss;
+  ss << "key-" << i;
+
+  return (ss.str());
+}
+
+
+void test_sized_bloom() {
+  const uint64_t n = 100000;
+  const double p = 0.01;
+  std::vector<BloomFilter<uint32_t, std::string>::hash_function> list;
+
+  BloomFilter<uint32_t, std::string> a(n, p);
+  CHECK(a.size() == bloom_optimal_bits(n, p));
+  CHECK(a.optimal_hashes() == 7);
+
+  list.push_back(hash32<1>);
+  list.push_back(hash32<2>);
+  list.push_back(hash32<3>);
+  list.push_back(hash32<4>);
+  list.push_back(hash32<5>);
+  list.push_back(hash32<6>);
+  list.push_back(hash32<7>);
+  a.setHash(list);
+
+  CHECK(a.memory() * 8 >= a.size());
+  CHECK(a.expected_fpp() < p * 1.1);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(key(i));
+  }
+  std::cout << "sized bloom: " << a.size() << " bits, " << a.memory() << " bytes, fpp "
+            << (double)fp / n << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 2 * p);
+}
+
+
+void test_blocked_bloom() {
+  const uint64_t n = 100000;
+  const double p = 0.01;
+
+  BlockedBloomFilter<uint32_t, std::string> a(n, p, hash32<1>);
+  CHECK(a.expected_fpp() <= p);
+  CHECK(a.memory() * 8 == a.size());
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+
+  BlockedBloomFilter<uint32_t, std::string> b(n, p, hash32<2>);
+  b = a;
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+    CHECK(b.exists(key(i)));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(key(i));
+  }
+  std::cout << "blocked bloom: " << a.size() << " bits, fpp " << (double)fp / n 
+            << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 2 * p);
+}
+
+
+void test_double_hash() {
+  const uint64_t n = 100000;
+  const double p = 0.01;
+
+  BloomFilter<uint32_t, std::string> a(n, p, 7u);
+  CHECK(a.hashes() == a.optimal_hashes());
+  CHECK(a.expected_fpp() < p * 1.1);
+
+  CountingBloomFilter<uint16_t, std::string> c(3, 4);
+  SpectralBloomFilter<uint16_t, std::string> sp(3, 4, 11);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  for (uint64_t i = 0; i < 1000; ++i) {
+    c.add(key(i));
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+  for (uint64_t i = 0; i < 1000; ++i) {
+    CHECK(c.exists(key(i)));
+  }
+  for (uint64_t i = 0; i < 1000; ++i) {
+    c.remove(key(i));
+  }
+  for (uint64_t i = 0; i < 1000; ++i) {
+    CHECK(!c.exists(key(i)));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(key(i));
+  }
+  std::cout << "double hashed bloom: " << a.hashes() << " hashes, fpp " << (double)fp / n 
+            << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 2 * p);
+
+  sp.add("abc");
+  sp.add("abc");
+  sp.add("abc");
+  sp.remove("abc");
+  CHECK(sp.occurrences("abc") == 2);
+}
+
+
+void test_batch() {
+  const uint64_t n = 10000;
+  std::vector<std::string> keys;
+  
+  for (uint64_t i = 0; i < 2 * n; ++i) {
+    keys.push_back(key(i));
+  }
+
+  BloomFilter<uint32_t, std::string> a(n, 0.01, 3u);
+  BloomFilter<uint32_t, std::string> b(n, 0.01, 3u);
+  CountingBloomFilter<uint16_t, std::string> c(3, 4);
+  SpectralBloomFilter<uint16_t, std::string> sp(3, 4);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(keys[i]);
+  }
+  std::vector<uint64_t> added = b.add_batch(&keys[0], n);
+  CHECK((added[0] & 1) == 0);
+  c.add_batch(&keys[0], n / 10);
+  sp.add_batch(&keys[0], 100);
+  sp.add_batch(&keys[0], 50);
+
+  // a key repeated inside one batch is reported as present
+  std::string twice[] = {"twice", "twice"};
+  std::vector<uint64_t> dup = b.add_batch(twice, 2);
+  CHECK(dup[0] == 2);
+
+  std::vector<uint64_t> found_a = a.exists_batch(&keys[0], keys.size());
+  std::vector<uint64_t> found_b = b.exists_batch(&keys[0], keys.size());
+  std::vector<uint64_t> found_c = c.exists_batch(&keys[0], keys.size());
+  std::vector<uint64_t> occurs = sp.occurrences_batch(&keys[0], 200);
+
+  CHECK(found_a.size() == (keys.size() + 63) / 64);
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    const bool bit_a = (found_a[i >> 6] >> (i & 63)) & 1;
+    const bool bit_b = (found_b[i >> 6] >> (i & 63)) & 1;
+    const bool bit_c = (found_c[i >> 6] >> (i & 63)) & 1;
+
+    CHECK(bit_a == a.exists(keys[i]));
+    CHECK(bit_b == bit_a);
+    CHECK(bit_c == c.exists(keys[i]));
+    if (i < n) {
+      CHECK(bit_a);
+    }
+    if (i < n / 10) {
+      CHECK(bit_c);
+    }
+  }
+  for (uint64_t i = 0; i < 200; ++i) {
+    CHECK(occurs[i] == sp.occurrences(keys[i]));
+  }
+  CHECK(occurs[0] == 2);
+  CHECK(occurs[75] == 1);
+}
+
+
+void test_concurrent() {
+  const uint64_t n = 100000;
+  const uint32_t threads = 4;
+  std::vector<std::string> keys;
+  std::vector<std::thread> pool;
+
+  for (uint64_t i = 0; i < 2 * n; ++i) {
+    keys.push_back(key(i));
+  }
+
+  ConcurrentBloomFilter<uint32_t, std::string> a(n, 0.01, 9u);
+  CHECK(a.hashes() == a.optimal_hashes());
+
+  // every thread adds its share of the keys and checks each one right away
+  for (uint32_t t = 0; t < threads; ++t) {
+    pool.push_back(std::thread([&a, &keys, t]() {
+          for (uint64_t i = t; i < n; i += threads) {
+            a.add(keys[i]);
+            CHECK(a.exists(keys[i]));
+          }
+        }));
+  }
+  for (uint32_t t = 0; t < threads; ++t) {
+    pool[t].join();
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(keys[i]));
+    fp += a.exists(keys[n + i]);
+  }
+  std::cout << "concurrent bloom: fpp " << (double)fp / n 
+            << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 0.02);
+}
+
+
+template <uint32_t Bits>
+void test_packed_array() {
+  const uint64_t n = 1000;
+  PackedBloomArray<Bits> a(n);
+  PackedBloomArray<Bits> b(n);
+  std::vector<uint64_t> idx;
+
+  CHECK(a.size() == n);
+  CHECK(a.memory() * 8 >= n * Bits);
+
+  // saturate at both ends without disturbing the neighbours
+  for (uint64_t i = 0; i < PackedBloomArray<Bits>::MAX + 3; ++i) {
+    a.inc(5);
+  }
+  CHECK(a.at(5) == PackedBloomArray<Bits>::MAX);
+  CHECK(a.at(4) == 0);
+  CHECK(a.at(6) == 0);
+  for (uint64_t i = 0; i < PackedBloomArray<Bits>::MAX + 3; ++i) {
+    a.dec(5);
+  }
+  CHECK(a.at(5) == 0);
+  a.set(7, 1);
+  CHECK(a.at(7) == 1);
+  a.set(7, PackedBloomArray<Bits>::MAX + 1);
+  CHECK(a.at(7) == 1);
+  a.clear();
+
+  for (uint64_t i = 0; i < 3 * n; ++i) {
+    idx.push_back((i * 7919) % n);
+  }
+  for (uint64_t i = 0; i < idx.size(); ++i) {
+    a.inc(idx[i]);
+  }
+  b.inc_bulk(&idx[0], idx.size());
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.at(i) == b.at(i));
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    a.dec(idx[i]);
+  }
+  b.dec_bulk(&idx[0], n);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.at(i) == b.at(i));
+  }
+
+  // lane-wise saturating sum and minimum
+  PackedBloomArray<Bits> c(n);
+  uint64_t nonzero = 0;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.set(i, (i * 31) % (PackedBloomArray<Bits>::MAX + 1));
+    b.set(i, (i * 17) % (PackedBloomArray<Bits>::MAX + 1));
+    nonzero += a.at(i) != 0;
+  }
+  CHECK(a.nonzero() == nonzero);
+  c = a;
+  c.merge_add(b);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(c.at(i) == std::min<uint64_t>(a.at(i) + b.at(i), PackedBloomArray<Bits>::MAX));
+  }
+  c = a;
+  c.merge_min(b);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(c.at(i) == std::min(a.at(i), b.at(i)));
+  }
+}
+
+
+void test_dleft() {
+  const uint64_t n = 100000;
+
+  DLeftCountingBloomFilter<uint32_t, std::string> a(n, 3);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  a.add(key(0));
+  CHECK(a.overflows() == 0);
+  CHECK(a.load_factor() <= 0.75);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(key(i));
+  }
+  std::cout << "d-left counting bloom: " << (double)a.memory() * 8 / n << " bits/key, fpp " 
+            << (double)fp / n << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 2 * a.expected_fpp() + 0.0005);
+
+  // key(0) was added twice
+  a.remove(key(0));
+  CHECK(a.exists(key(0)));
+  a.remove(key(0));
+  for (uint64_t i = 1; i < n / 2; ++i) {
+    a.remove(key(i));
+  }
+  CHECK(!a.exists(key(0)));
+  for (uint64_t i = n / 2; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+  CHECK(a.load_factor() < 0.4);
+
+  // overfill a small filter: a failed add reports it, and the keys that
+  // were added are all still there
+  DLeftCountingBloomFilter<uint32_t, std::string> b(100, 3);
+  std::vector<uint64_t> added;
+  uint64_t failed = 0;
+  for (uint64_t i = 0; i < 2 * b.size(); ++i) {
+    if (b.add(key(i))) {
+      added.push_back(i);
+    } else {
+      ++failed;
+    }
+  }
+  CHECK(failed > 0 && b.overflows() == failed);
+  CHECK(b.load_factor() > 0.9);
+  for (uint64_t i = 0; i < added.size(); ++i) {
+    CHECK(b.exists(key(added[i])));
+  }
+  CHECK(b.add(key(added[0])));
+  CHECK(b.overflows() == failed);
+}
+
+
+template <uint32_t Bits>
+void test_cuckoo() {
+  const uint64_t n = 100000;
+
+  CuckooFilter<uint32_t, std::string, Bits> a(n, 5);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  CHECK(a.overflows() == 0);
+  CHECK(a.load_factor() <= 0.95);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(key(i));
+  }
+  std::cout << "cuckoo filter (" << Bits << " bit): " << (double)a.memory() * 8 / n 
+            << " bits/key, load " << a.load_factor() << ", fpp " << (double)fp / n 
+            << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 1.5 * a.expected_fpp() + 0.0005);
+
+  for (uint64_t i = 0; i < n / 2; ++i) {
+    a.remove(key(i));
+  }
+  for (uint64_t i = n / 2; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+  CHECK(a.load_factor() < 0.5);
+
+  // fill past capacity: the first failed add reports it, and nothing 
+  // added before is lost
+  CuckooFilter<uint32_t, std::string, Bits> b(1000, 5);
+  uint64_t added = 0;
+  while (b.add(key(added))) {
+    ++added;
+  }
+  CHECK(b.overflows() == 1);
+  CHECK(b.load_factor() > 0.9);
+  CHECK(!b.add(key(added + 1)));
+  CHECK(b.overflows() == 2);
+  for (uint64_t i = 0; i < added; ++i) {
+    CHECK(b.exists(key(i)));
+  }
+  // removes make room again
+  for (uint64_t i = 0; i < added / 2; ++i) {
+    b.remove(key(i));
+  }
+  CHECK(b.add(key(added)));
+  CHECK(b.exists(key(added)));
+}
+
+
+// 4 bit fingerprints: four 16 bit buckets per word, and too few distinct
+// fingerprints to fill the table as far as test_cuckoo does
+void test_cuckoo_4() {
+  const uint64_t n = 10000;
+
+  CuckooFilter<uint32_t, std::string, 4> a(n, 5, 0.5);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.add(key(i)));
+  }
+  CHECK(a.memory() * 8 == (n * 2 / 4 + 1 + 3) / 4 * 64);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+  for (uint64_t i = 0; i < n / 2; ++i) {
+    a.remove(key(i));
+  }
+  for (uint64_t i = n / 2; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+  CHECK(a.load_factor() < 0.3);
+}
+
+
+template <class F>
+void test_binary_fuse() {
+  const uint64_t n = 1000000;
+  std::vector<uint64_t> keys;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys.push_back(i * 0x9e3779b97f4a7c15ULL);
+  }
+  // duplicates are allowed
+  keys.push_back(keys[0]);
+
+  BinaryFuseFilter<uint64_t, F> a;
+  CHECK(!a.exists(keys[0]));
+  CHECK(a.build(keys, 4));
+  CHECK(a.size() == n);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(keys[i]));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(i * 0x9e3779b97f4a7c15ULL);
+  }
+  std::cout << "binary fuse filter (" << sizeof(F) * 8 << " bit): " << (double)a.memory() * 8 / n 
+            << " bits/key, fpp " << (double)fp / n << " (expected " << a.expected_fpp() << ")" << std::endl;
+  CHECK((double)fp / n < 1.5 * a.expected_fpp() + 0.00005);
+
+  // the same keys from a file give the same filter
+  const char *path = "binary_fuse_keys.tmp";
+  std::ofstream out(path, std::ios::binary);
+  out.write((const char *)&keys[0], keys.size() * sizeof(uint64_t));
+  out.close();
+
+  BinaryFuseFilter<uint64_t, F> b;
+  CHECK(b.build_from_file(path, 2));
+  remove(path);
+  CHECK(!b.build_from_file(path));
+  CHECK(b.memory() == a.memory());
+  for (uint64_t i = 0; i < 2 * n; ++i) {
+    CHECK(a.exists(i * 0x9e3779b97f4a7c15ULL) == b.exists(i * 0x9e3779b97f4a7c15ULL));
+  }
+
+  // consecutive uint64_t keys must be hashed, not used as the hash
+  std::vector<uint64_t> dense;
+  for (uint64_t i = 0; i < n; ++i) {
+    dense.push_back(i);
+  }
+  BinaryFuseFilter<uint64_t, F> d;
+  CHECK(d.build(dense));
+  CHECK(d.size() == n);
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(d.exists(i));
+  }
+  fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += d.exists(i);
+  }
+  CHECK((double)fp / n < 1.5 * d.expected_fpp() + 0.00005);
+  CHECK(DoubleHash(dense[1], BinaryFuseFilter<uint64_t, F>::HASH_SEED).h1() != dense[1]);
+
+  std::vector<std::string> strings;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    strings.push_back(key(i));
+  }
+  BinaryFuseFilter<std::string, F> c;
+  CHECK(c.build(strings));
+  for (uint64_t i = 0; i < 1000; ++i) {
+    CHECK(c.exists(key(i)));
+  }
+}
+
+
+void test_set_ops() {
+  const uint64_t n = 20000;
+  BloomFilter<uint32_t, std::string> a(2 * n, 0.01, 1u);
+  BloomFilter<uint32_t, std::string> b(2 * n, 0.01, 1u);
+  BloomFilter<uint32_t, std::string> all(2 * n, 0.01, 1u);
+  BloomFilter<uint32_t, std::string> other(2 * n, 0.01, 2u);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+    b.add(key(n / 2 + i));
+    all.add(key(i));
+    all.add(key(n / 2 + i));
+  }
+
+  CHECK(std::abs(a.estimate_cardinality() - n) < n * 0.03);
+  CHECK(a.fill_ratio() > 0.0 && a.fill_ratio() < 1.0);
+  CHECK(!a.merge_union(other));
+
+  BloomFilter<uint32_t, std::string> u = a;
+  CHECK(u.merge_union(b));
+  CHECK(u.popcount() == all.popcount());
+  CHECK(std::abs(u.estimate_cardinality() - 1.5 * n) < n * 0.05);
+  for (uint64_t i = 0; i < n + n / 2; ++i) {
+    CHECK(u.exists(key(i)));
+  }
+
+  std::vector<const BloomFilter<uint32_t, std::string> *> shards;
+  BloomFilter<uint32_t, std::string> s(2 * n, 0.01, 1u);
+  shards.push_back(&a);
+  shards.push_back(&b);
+  CHECK(s.merge_union(shards));
+  CHECK(s.popcount() == all.popcount());
+
+  BloomFilter<uint32_t, std::string> x = a;
+  CHECK(x.intersect(b));
+  CHECK(x.popcount() <= std::min(a.popcount(), b.popcount()));
+  for (uint64_t i = n / 2; i < n; ++i) {
+    CHECK(x.exists(key(i)));
+  }
+
+  std::vector<CountingBloomFilter<uint32_t, std::string>::hash_function> list;
+  list.push_back(hash32<1>);
+  list.push_back(hash32<2>);
+  list.push_back(hash32<3>);
+  SpectralBloomFilter<uint32_t, std::string> c(CountingBloomFilter<uint32_t, std::string>(n, 0.01, list));
+  SpectralBloomFilter<uint32_t, std::string> d(c);
+
+  for (uint64_t i = 0; i < n / 2; ++i) {
+    c.add(key(i));
+    d.add(key(i));
+    d.add(key(n + i));
+  }
+  CHECK(std::abs(c.estimate_cardinality() - n / 2) < n * 0.03);
+  CHECK(c.merge_union(d));
+  for (uint64_t i = 0; i < n / 2; ++i) {
+    CHECK(c.occurrences(key(i)) >= 2);
+    CHECK(c.exists(key(n + i)));
+  }
+  CHECK(d.intersect(c));
+  for (uint64_t i = 0; i < n / 2; ++i) {
+    CHECK(d.exists(key(n + i)));
+  }
+}
+
+void test_scalable() {
+  const uint64_t n = 100000;
+  const double p = 0.01;
+  ScalableBloomFilter<uint32_t, std::string> a(n / 100, p, 3u);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    fp += a.exists(key(i));
+  }
+
+  CHECK(a.stages() == 7);
+  CHECK(a.count() <= n && a.count() > n * 0.99);
+  CHECK(a.expected_fpp() < p);
+  CHECK((double)fp / n < p);
+  CHECK(a.memory() < bloom_optimal_bits(n, p * 0.15 * 0.85 * 0.85 * 0.85) / 8 * 2);
+  for (uint64_t i = 0; i + 1 < a.stages(); ++i) {
+    CHECK(a.stage_capacity(i + 1) == 2 * a.stage_capacity(i));
+    CHECK(a.stage_hashes(i + 1) >= a.stage_hashes(i));
+    CHECK(a.stage_count(i) == a.stage_capacity(i));
+    CHECK(a.stage_fill(i) > 0.4 && a.stage_fill(i) < 0.6);
+  }
+  std::cout << "scalable bloom: " << a.stages() << " stages, " << a.memory() * 8.0 / n 
+            << " bits/key, fpp " << (double)fp / n << " (expected " << a.expected_fpp() << ")" << std::endl;
+
+  // repeated keys don't grow the filter
+  a.clear();
+  CHECK(a.stages() == 1);
+  CHECK(!a.exists(key(1)));
+  for (uint64_t i = 0; i < 10 * n; ++i) {
+    a.add(key(i % (n / 200)));
+  }
+  CHECK(a.stages() == 1);
+}
+
+void test_generational() {
+  const uint64_t n = 12000;
+  const uint32_t g = 4;
+  const uint64_t span = 60;
+  GenerationalBloomFilter<uint32_t, std::string> a(n, 0.01, g, span, 1200, 5u);
+  std::vector<std::vector<std::string> > keys(10);
+
+  for (uint64_t gen = 0; gen < keys.size(); ++gen) {
+    for (uint64_t i = 0; i < n; ++i) {
+      keys[gen].push_back(key(gen * n + i));
+    }
+  }
+
+  // only a tenth of the keys in generation 1, so its spare is still 
+  // being cleared when generation 2 starts
+  for (uint64_t gen = 0; gen < keys.size(); ++gen) {
+    a.advance(1200 + gen * span + span / 2);
+    a.advance(1200);
+    CHECK(a.generation() == (1200 + gen * span) / span);
+    for (uint64_t i = 0; i < (gen == 1 ? n / 10 : n); ++i) {
+      a.add(keys[gen][i]);
+    }
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t gen = 0; gen < keys.size(); ++gen) {
+    for (uint64_t i = 0; i < n; ++i) {
+      if (gen + g >= keys.size()) {
+        CHECK(a.exists(keys[gen][i]));
+      } else {
+        fp += a.exists(keys[gen][i]);
+      }
+    }
+  }
+  CHECK((double)fp / (n * (keys.size() - g)) < 0.01 * 1.1);
+  CHECK(a.expected_fpp(n) < 0.01 * 1.1);
+  // a bit position costs generations + 1 bits (64 / 5 positions a word)
+  CHECK(a.memory() * 8 == a.size() / 12 * 64);
+  GenerationalBloomFilter<uint32_t, std::string> two(n, 0.01, 2, span);
+  CHECK(two.memory() * 8 == two.size() / 21 * 64);
+  std::cout << "generational bloom: " << a.memory() * 8.0 / (n * g) << " bits/key, fpp " 
+            << (double)fp / (n * (keys.size() - g)) << " (expected " << a.expected_fpp(n) << ")" << std::endl;
+
+  // one generation later the oldest is gone, g later all of them are
+  a.advance(1200 + keys.size() * span);
+  CHECK(!a.exists(keys[keys.size() - g][0]) || !a.exists(keys[keys.size() - g][1]));
+  CHECK(a.exists(keys[keys.size() - 1][0]));
+  a.advance(1200 + (keys.size() + g) * span);
+  fp = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    fp += a.exists(keys[keys.size() - 1][i]);
+  }
+  CHECK(fp == 0);
+}
+
+struct Connection {
+  uint32_t id;
+  FixedBloom<1024, 5> seen;
+};
+
+void test_fixed() {
+  typedef FixedBloom<1024, 5> Small;
+  typedef FixedBloom<1000, 4, FixedBloomHash> Odd;
+  const uint64_t n = 100;
+
+  static_assert(std::is_trivially_copyable<Small>::value, "");
+  static_assert(std::is_trivially_copyable<Connection>::value, "");
+  static_assert(sizeof(Small) == 128, "");
+  static_assert(Small::memory() == 128 && Odd::memory() == 128, "");
+  static_assert(is_bloom<Odd, std::string>::value, "");
+
+  Connection a;
+  Connection b;
+  Odd c;
+  Odd d;
+
+  a.id = 1;
+  a.seen.clear();
+  for (uint64_t i = 0; i < n; ++i) {
+    a.seen.add(key(i));
+    c.add(i);
+  }
+  memcpy(&b, &a, sizeof(a));
+  
+  uint64_t fp = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(b.seen.exists(key(i)));
+    CHECK(c.exists(i));
+  }
+  for (uint64_t i = n; i < 100 * n; ++i) {
+    fp += b.seen.exists(key(i));
+    CHECK(!d.exists(i));
+  }
+  CHECK((double)fp / (99 * n) < Small::expected_fpp(n) * 1.5);
+  CHECK(b.seen.popcount() == a.seen.popcount());
+
+  d.merge_union(c);
+  CHECK(d.popcount() == c.popcount());
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(d.exists(i));
+  }
+
+  // the StaticBloom range helpers
+  std::vector<uint64_t> more;
+  for (uint64_t i = 0; i < n; ++i) {
+    more.push_back(1000 + i);
+  }
+  CHECK(c.count_present(more.begin(), more.end()) < n / 10);
+  c.add_range(more.begin(), more.end());
+  CHECK(c.count_present(more.begin(), more.end()) == n);
+
+  // the full 32 bit range of the double hash reaches the last bit (taking
+  // the address instantiates exists(), and its static_assert, without a 
+  // 512 MB filter)
+  bool (FixedBloom<((uint64_t)1 << 32), 1>::*top)(const uint64_t &) const =
+    &FixedBloom<((uint64_t)1 << 32), 1>::exists<uint64_t>;
+  bool (FixedBloom<((uint64_t)1 << 32) - 1, 1>::*below)(const uint64_t &) const =
+    &FixedBloom<((uint64_t)1 << 32) - 1, 1>::exists<uint64_t>;
+  CHECK(top && below);
+}
+
+void test_bank() {
+  const uint64_t filters = 300;
+  const uint64_t n = 200;
+  BloomFilterBank<uint32_t, std::string> a(filters, n, 0.01, 9u);
+  std::vector<uint64_t> out(a.words_per_row());
+
+  CHECK(!a.query(key(0), &out[0]));
+  CHECK(a.words_per_row() % 4 == 0);
+  CHECK(a.words_per_row() * 64 >= filters);
+  for (uint64_t j = 0; j < filters; ++j) {
+    for (uint64_t i = 0; i < n; ++i) {
+      a.add(j, key(j * n + i));
+    }
+  }
+
+  uint64_t fp = 0;
+  for (uint64_t j = 0; j < filters; ++j) {
+    for (uint64_t i = 0; i < n; i += 10) {
+      CHECK(a.exists(j, key(j * n + i)));
+      CHECK(a.query(key(j * n + i), &out[0]));
+      CHECK((out[j >> 6] >> (j & 63)) & 1);
+      for (uint64_t w = 0; w < out.size(); ++w) {
+        fp += __builtin_popcountll(out[w]);
+      }
+      --fp;
+      CHECK(a.query(key(j * n + i)) == out);
+    }
+  }
+  CHECK((double)fp / (filters * (n / 10) * (filters - 1)) < a.expected_fpp() * 1.5);
+
+  a.clear(7);
+  CHECK(!a.exists(7, key(7 * n)));
+  CHECK(a.exists(8, key(8 * n)));
+  a.query(key(7 * n), &out[0]);
+  CHECK(!(out[0] & (1 << 7)));
+}
+
+// flip one byte of the file at path
+void corrupt(const char *path, const uint64_t offset) {
+  std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+  char c;
+
+  f.seekg(offset);
+  f.get(c);
+  f.seekp(offset);
+  f.put(c ^ 1);
+}
+
+void test_file() {
+  const uint64_t n = 10000;
+  const char *path = "bloom_file.tmp";
+  BloomFilter<uint32_t, std::string> a(n, 0.01, 7u);
+  BloomFilter<uint32_t, std::string> b(1, 0.5, 1u);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  CHECK(a.save(path));
+  CHECK(b.load(path, true));
+  CHECK(b.mapped());
+  CHECK(b.size() == a.size());
+  CHECK(b.hashes() == a.hashes());
+  CHECK(b.expected_fpp() == a.expected_fpp());
+  CHECK(b.popcount() == a.popcount());
+  for (uint64_t i = 0; i < 2 * n; ++i) {
+    CHECK(b.exists(key(i)) == a.exists(key(i)));
+  }
+
+  // changes to a mapped filter stay private to it
+  BloomFilter<uint32_t, std::string> c = b;
+  CHECK(!c.mapped());
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    b.add(key(i));
+  }
+  CHECK(c.load(path));
+  CHECK(c.popcount() == a.popcount());
+
+  // hash_list filters need the same number of hash functions
+  std::vector<BloomFilter<uint32_t, std::string>::hash_function> list;
+  list.push_back(hash32<1>);
+  list.push_back(hash32<2>);
+  BloomFilter<uint32_t, std::string> d(n, 0.01, list);
+  BloomFilter<uint32_t, std::string> e(1, 0.5, list);
+  d.add(key(1));
+  CHECK(d.save(path));
+  CHECK(!c.load(path));
+  CHECK(e.load(path));
+  CHECK(e.exists(key(1)));
+
+  // a damaged array is only caught by verify, a damaged header always
+  corrupt(path, sizeof(BloomFileHeader) + 3);
+  CHECK(e.load(path));
+  CHECK(!e.load(path, true));
+  corrupt(path, 20);
+  CHECK(!e.load(path));
+
+  CountingBloomFilter<uint32_t, std::string> f(CountingBloomFilter<uint32_t, std::string>(n, 0.01, list));
+  SpectralBloomFilter<uint32_t, std::string> g(CountingBloomFilter<uint32_t, std::string>(1, 0.5, list));
+  CountingBloomFilter<uint32_t, std::string, 8> h(CountingBloomFilter<uint32_t, std::string, 8>(1, 0.5, list));
+  for (uint64_t i = 0; i < 5; ++i) {
+    f.add(key(1));
+  }
+  CHECK(f.save(path));
+  CHECK(!b.load(path));
+  CHECK(!h.load(path));
+  CHECK(g.load(path, true));
+  CHECK(g.mapped());
+  CHECK(g.occurrences(key(1)) == 5);
+  g.remove(key(1));
+  CHECK(g.occurrences(key(1)) == 4);
+
+  remove(path);
+  CHECK(!g.load(path));
+}
+
+// a pipeline stage templated on the filter type: passes on keys not yet seen
+template <class F>
+uint64_t dedup_stage(F &filter, const std::vector<std::string> &keys) {
+  static_assert(is_bloom<F, std::string>::value, "dedup_stage needs a filter");
+  uint64_t ret = 0;
+
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    if (!filter.exists(keys[i])) {
+      filter.add(keys[i]);
+      ++ret;
+    }
+  }
+
+  return (ret);
+}
+
+void test_static_interface() {
+  const uint64_t n = 1000;
+  std::vector<std::string> keys;
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys.push_back(key(i % (n / 2)));
+  }
+
+  static_assert(is_bloom<BloomFilter<uint32_t, std::string>, std::string>::value, "");
+  static_assert(is_bloom<CuckooFilter<uint32_t, std::string>, std::string>::value, "");
+  static_assert(!is_bloom<BinaryFuseFilter<std::string>, std::string>::value, "");
+  static_assert(!is_bloom<std::string, std::string>::value, "");
+
+  BloomFilter<uint32_t, std::string> a(n, 0.0001, 1u);
+  CHECK(dedup_stage(a, keys) == n / 2);
+
+  BlockedBloomFilter<uint32_t, std::string> b(n, 0.0001, hash32<1>);
+  CuckooFilter<uint32_t, std::string> c(n);
+  CountingBloomFilter<uint32_t, std::string> d(n, 0.0001, std::vector<CountingBloomFilter<uint32_t, std::string>::hash_function>(1, hash32<1>));
+  std::vector<AnyBloom<uint32_t, std::string> > any;
+  
+  any.push_back(AnyBloom<uint32_t, std::string>(b));
+  any.push_back(AnyBloom<uint32_t, std::string>(c));
+  any.push_back(AnyBloom<uint32_t, std::string>(d));
+  for (uint32_t i = 0; i < any.size(); ++i) {
+    any[i].add_range(keys.begin(), keys.end());
+  }
+  CHECK(b.count_present(keys.begin(), keys.end()) == n);
+  CHECK(c.exists(keys[0]));
+  CHECK(d.exists(keys[0]));
+
+  Bloom<uint32_t, std::string> &dynamic = any[1];
+  CHECK(dynamic.exists(keys[1]));
+}
+
+
+int main() {
+  test_sized_bloom();
+  test_blocked_bloom();
+  test_double_hash();
+  test_batch();
+  test_concurrent();
+  test_packed_array<1>();
+  test_packed_array<2>();
+  test_packed_array<4>();
+  test_packed_array<8>();
+  test_dleft();
+  test_cuckoo<8>();
+  test_cuckoo<16>();
+  test_cuckoo_4();
+  test_binary_fuse<uint8_t>();
+  test_binary_fuse<uint16_t>();
+  test_set_ops();
+  test_file();
+  test_scalable();
+  test_generational();
+  test_fixed();
+  test_bank();
+  test_static_interface();
+
+  std::cout << "all tests passed" << std::endl;
+  return (0);
+}
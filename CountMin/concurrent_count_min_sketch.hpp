@@ -0,0 +1,275 @@
+/*
+ * concurrent_count_min_sketch.hpp
+ *
+ *
+ * Concurrent Count-Min Sketch Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __CONCURRENT_COUNT_MIN_SKETCH__
+#define __CONCURRENT_COUNT_MIN_SKETCH__
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <cassert>
+#include <stdint.h>
+
+#include "count_min_sketch.hpp"
+
+
+// Whether std::atomic<C> is always lock free, for an integral C
+template <class C>
+struct cms_atomic_lock_free {
+  static const bool value = std::is_integral<C>::value &&
+    ((sizeof(C) == sizeof(char) && ATOMIC_CHAR_LOCK_FREE == 2) ||
+     (sizeof(C) == sizeof(short) && ATOMIC_SHORT_LOCK_FREE == 2) ||
+     (sizeof(C) == sizeof(int) && ATOMIC_INT_LOCK_FREE == 2) ||
+     (sizeof(C) == sizeof(long) && ATOMIC_LONG_LOCK_FREE == 2) ||
+     (sizeof(C) == sizeof(long long) && ATOMIC_LLONG_LOCK_FREE == 2));
+};
+
+
+// A CountMinSketch that any number of threads may update and query at
+// the same time, without locks. Counters are updated in one of two ways:
+//
+// - add() increments the shared counters with relaxed atomic adds. Every
+//   update is visible at once, but threads adding the same hot keys
+//   contend for their cache lines.
+//
+// - A Writer (one per thread) counts into a private delta sketch of the
+//   same shape with one byte per counter (a quarter of the shared table
+//   for 32 bit counters), and adds it to the shared counters every 
+//   interval updates (and when flushed or destroyed). Updates become
+//   visible up to interval updates late, and a shared counter is only
+//   written once per flush, or once per 256 counts added to it.
+//
+// estimate() may run concurrently with both. Indices are derived from
+// one DoubleHash of the key with cms_column, as in CountMinSketch.
+template <class T, class C = uint32_t>
+class ConcurrentCountMinSketch {
+public:
+
+  static_assert(cms_atomic_lock_free<C>::value, "counters must be lock free");
+
+  // counters per cache line
+  static const uint64_t LINE = 64 / sizeof(C);
+
+  ConcurrentCountMinSketch(const double epsilon, const double delta, const uint32_t seed = 0) :
+    width_(cms_width(epsilon)),
+    depth_(cms_depth(delta)),
+    stride_((width_ + LINE - 1) / LINE * LINE),
+    array_(new std::atomic<C>[depth_ * stride_ + LINE - 1]),
+    table_((std::atomic<C> *)(((uintptr_t)array_.get() + 63) & ~(uintptr_t)63)),
+    seed_(seed)
+  {
+    assert(width_ <= ((uint64_t)1 << 32));
+    clear();
+  }
+
+  ConcurrentCountMinSketch(const ConcurrentCountMinSketch<T,C> &) = delete;
+  ConcurrentCountMinSketch<T,C> &operator=(const ConcurrentCountMinSketch<T,C> &) = delete;
+
+  void add(const T &s, const C count = 1) {
+    const DoubleHash h(s, seed_);
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      table_[offset(h, i)].fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+
+  C estimate(const T &s) const {
+    const DoubleHash h(s, seed_);
+    C ret = std::numeric_limits<C>::max();
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      ret = std::min(ret, table_[offset(h, i)].load(std::memory_order_relaxed));
+    }
+
+    return (ret);
+  }
+
+  // Sum of all counts added (and flushed). Every update adds to exactly
+  // one counter of each row, so this is the sum of the first row.
+  uint64_t total() const {
+    uint64_t ret = 0;
+
+    for (uint64_t i = 0; i < width_; ++i) {
+      ret += table_[i].load(std::memory_order_relaxed);
+    }
+
+    return (ret);
+  }
+
+  // Not safe to call concurrently with updates
+  void clear() {
+    for (uint64_t i = 0; i < depth_ * stride_; ++i) {
+      table_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // counters per row
+  uint64_t width() const {
+    return (width_);
+  }
+
+  // number of rows
+  uint32_t depth() const {
+    return (depth_);
+  }
+
+  // bytes used by the shared counters
+  uint64_t memory() const {
+    return (depth_ * stride_ * sizeof(C));
+  }
+
+
+  // Per-thread update handle: counts into a delta sketch of the same shape
+  // with one byte per counter, which is added to the shared one every 
+  // interval updates. A delta counter that would pass 255 adds its high
+  // part to the shared counter at once and keeps the low byte. A Writer 
+  // must only be used by one thread at a time, and must not outlive the
+  // sketch.
+  class Writer {
+  public:
+
+    Writer(ConcurrentCountMinSketch<T,C> &sketch, const uint64_t interval = 65536) :
+      sketch_(sketch),
+      delta_((sketch.depth_ * sketch.stride_ + 63) / 64 * 64, 0),
+      interval_(interval),
+      pending_(0)
+    {
+      assert(interval);
+    }
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    ~Writer() {
+      flush();
+    }
+
+    void add(const T &s, const C count = 1) {
+      const DoubleHash h(s, sketch_.seed_);
+
+      for (uint32_t i = 0; i < sketch_.depth_; ++i) {
+        const uint64_t off = sketch_.offset(h, i);
+        // modulo 2^64, so negative counts of a signed C carry correctly
+        const uint64_t sum = delta_[off] + (uint64_t)count;
+
+        if (sum > 0xff) {
+          sketch_.table_[off].fetch_add((C)(sum & ~(uint64_t)0xff), std::memory_order_relaxed);
+        }
+        delta_[off] = (uint8_t)sum;
+      }
+      if (++pending_ == interval_) {
+        flush();
+      }
+    }
+
+    // Add the delta to the shared counters and reset it. The delta is
+    // scanned a cache line at a time (an OR the compiler vectorizes), and
+    // only the nonzero counters of lines that were touched are added.
+    void flush() {
+      const uint64_t n = delta_.size();
+      std::atomic<C> *table = sketch_.table_;
+
+      for (uint64_t b = 0; b < n; b += 64) {
+        uint8_t any = 0;
+
+        for (uint64_t i = b; i < b + 64; ++i) {
+          any |= delta_[i];
+        }
+        if (!any) {
+          continue;
+        }
+        for (uint64_t i = b; i < b + 64; ++i) {
+          if (delta_[i]) {
+            table[i].fetch_add(delta_[i], std::memory_order_relaxed);
+            delta_[i] = 0;
+          }
+        }
+      }
+      pending_ = 0;
+    }
+
+    // number of updates not yet flushed
+    uint64_t pending() const {
+      return (pending_);
+    }
+
+    // bytes used by the delta sketch
+    uint64_t memory() const {
+      return (delta_.size());
+    }
+
+  private:
+    ConcurrentCountMinSketch<T,C> &sketch_;
+    // low byte of the pending count of each counter, laid out as table_
+    std::vector<uint8_t> delta_;
+    uint64_t interval_;
+    uint64_t pending_;
+  };
+
+private:
+
+  // offset of the counter of row i from table_, as CountMinSketch
+  inline uint64_t offset(const DoubleHash &h, const uint32_t i) const {
+    return (i * stride_ + cms_column(h[i], width_));
+  }
+
+  uint64_t width_;
+  uint32_t depth_;
+  // counters from the start of one row to the next
+  uint64_t stride_;
+  std::unique_ptr<std::atomic<C>[]> array_;
+  // first cache line aligned counter of array_
+  std::atomic<C> *table_;
+  uint32_t seed_;
+};
+
+
+#endif
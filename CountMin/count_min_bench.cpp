@@ -0,0 +1,399 @@
+/*
+ * count_min_bench.cpp
+ *
+ *
+ * Count-Min Sketch Benchmark
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <sstream>
+
+#include "count_min_sketch.hpp"
+#include "concurrent_count_min_sketch.hpp"
+#include "top_k.hpp"
+#include "dyadic_count_min.hpp"
+#include "count_sketch.hpp"
+#include "../StreamSummary/c++/stream_summary.hpp"
+
+
+static uint64_t splitmix(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return (z ^ (z >> 31));
+}
+
+class Timer {
+public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  double ns_per(const uint64_t ops) const {
+    std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start_;
+
+    return (d.count() / ops);
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+static void report(const std::string &name, const std::string &op, const double ns) {
+  std::cout << std::left << std::setw(28) << name << std::setw(10) << op
+            << std::fixed << std::setprecision(2) << ns << " ns/op" << std::endl;
+}
+
+// keys drawn from a skewed set of distinct values
+static std::vector<uint64_t> make_keys(const uint64_t n, uint64_t state) {
+  std::vector<uint64_t> ret(n);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    const uint64_t r = splitmix(state);
+
+    ret[i] = (r % 1000000) * (r >> 60);
+  }
+
+  return (ret);
+}
+
+
+template <class C>
+void bench_batch(const std::string &name, const uint64_t n, const double epsilon, const double delta) {
+  const std::vector<uint64_t> keys = make_keys(n, 7);
+  std::vector<C> out(n);
+  CountMinSketch<uint64_t, uint64_t, C> a =
+    CountMinSketch<uint64_t, uint64_t, C>::from_error(epsilon, delta, 1u);
+  CountMinSketch<uint64_t, uint64_t, C> b =
+    CountMinSketch<uint64_t, uint64_t, C>::from_error(epsilon, delta, 1u);
+  uint64_t sum = 0;
+
+  Timer add;
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(keys[i]);
+  }
+  report(name, "add", add.ns_per(n));
+
+  Timer add_batch;
+  b.add_batch(&keys[0], n);
+  report(name + " (batch)", "add", add_batch.ns_per(n));
+
+  Timer estimate;
+  for (uint64_t i = 0; i < n; ++i) {
+    sum += a.estimate(keys[i]);
+  }
+  report(name, "estimate", estimate.ns_per(n));
+
+  Timer estimate_batch;
+  b.estimate_batch(&keys[0], n, &out[0]);
+  report(name + " (batch)", "estimate", estimate_batch.ns_per(n));
+
+  for (uint64_t i = 0; i < n; ++i) {
+    sum -= out[i];
+  }
+  std::cout << std::left << std::setw(28) << name << std::setw(10) << "memory"
+            << a.memory() << " bytes, " << a.depth() << " rows" 
+            << (sum ? ", batch mismatch" : "") << std::endl;
+}
+
+
+// run f(t) on threads threads and report the time per update over all
+template <class F>
+void run_threads(const std::string &name, const uint32_t threads, const uint64_t n, F f) {
+  std::vector<std::thread> pool;
+  std::stringstream ss;
+
+  ss << name << " (" << threads << " thr)";
+
+  Timer timer;
+  for (uint32_t t = 0; t < threads; ++t) {
+    pool.push_back(std::thread(f, t));
+  }
+  for (uint32_t t = 0; t < threads; ++t) {
+    pool[t].join();
+  }
+  report(ss.str(), "add", timer.ns_per(n));
+}
+
+// Throughput of n updates spread over 1, 2, 4, ... threads: a 
+// CountMinSketch behind a mutex, atomic adds to shared counters, and 
+// per-thread delta sketches
+void bench_concurrent(const uint64_t n, const uint32_t max_threads) {
+  const std::vector<uint64_t> keys = make_keys(n, 11);
+
+  for (uint32_t threads = 1; threads <= max_threads; threads <<= 1) {
+    CountMinSketch<uint64_t, uint64_t, uint32_t> locked =
+      CountMinSketch<uint64_t, uint64_t, uint32_t>::from_error(0.0001, 0.01, 1u);
+    ConcurrentCountMinSketch<uint64_t> shared(0.0001, 0.01, 1u);
+    std::mutex lock;
+
+    run_threads("CMS mutex", threads, n, [&](const uint32_t t) {
+        for (uint64_t i = t; i < n; i += threads) {
+          std::lock_guard<std::mutex> guard(lock);
+          locked.add(keys[i]);
+        }
+      });
+    shared.clear();
+    run_threads("CMS atomic", threads, n, [&](const uint32_t t) {
+        for (uint64_t i = t; i < n; i += threads) {
+          shared.add(keys[i]);
+        }
+      });
+    shared.clear();
+    run_threads("CMS delta", threads, n, [&](const uint32_t t) {
+        ConcurrentCountMinSketch<uint64_t>::Writer w(shared, 1 << 20);
+
+        for (uint64_t i = t; i < n; i += threads) {
+          w.add(keys[i]);
+        }
+      });
+  }
+}
+
+
+// merge serialized shards into one sketch, as an aggregator would
+void bench_merge(const uint32_t shards) {
+  const std::vector<uint64_t> keys = make_keys(100000, 13);
+  CountMinSketch<uint64_t, uint64_t, uint32_t> shard =
+    CountMinSketch<uint64_t, uint64_t, uint32_t>::from_error(0.0001, 0.01, 1u);
+  CountMinSketch<uint64_t, uint64_t, uint32_t> merged =
+    CountMinSketch<uint64_t, uint64_t, uint32_t>::from_error(0.0001, 0.01, 1u);
+  CountMinSketch<uint64_t, uint64_t, uint32_t> copy =
+    CountMinSketch<uint64_t, uint64_t, uint32_t>::from_error(0.0001, 0.01, 1u);
+  std::vector<std::string> wire;
+
+  shard.add_batch(&keys[0], keys.size());
+  for (uint32_t i = 0; i < shards; ++i) {
+    wire.push_back(shard.serialize());
+  }
+
+  Timer sketch;
+  for (uint32_t i = 0; i < shards; ++i) {
+    merged.merge(shard);
+  }
+  report("CMS 32 bit 544 KB", "merge", sketch.ns_per(shards));
+
+  Timer from_wire;
+  for (uint32_t i = 0; i < shards; ++i) {
+    merged.merge(wire[i]);
+  }
+  report("CMS 32 bit 544 KB (wire)", "merge", from_wire.ns_per(shards));
+
+  Timer deserialize;
+  for (uint32_t i = 0; i < shards; ++i) {
+    copy.deserialize(wire[i]);
+  }
+  report("CMS 32 bit 544 KB (wire)", "load", deserialize.ns_per(shards));
+
+  if (merged.total() != 2 * (uint64_t)shards * keys.size() || copy.total() != shard.total()) {
+    std::cout << "merge mismatch" << std::endl;
+  }
+}
+
+
+// heavy hitters with TopK against a sketch and a StreamSummary side by side
+void bench_topk(const uint64_t n, const uint32_t k) {
+  const std::vector<uint64_t> keys = make_keys(n, 17);
+  TopK<uint64_t> top(k, 0.0001, 0.01, 1u);
+  CountMinSketch<uint64_t, uint64_t, uint32_t> sketch =
+    CountMinSketch<uint64_t, uint64_t, uint32_t>::from_error(0.0001, 0.01, 1u);
+  StreamSummary<uint64_t> summary(k);
+
+  Timer t;
+  for (uint64_t i = 0; i < n; ++i) {
+    top.add(keys[i]);
+  }
+  report("TopK", "add", t.ns_per(n));
+
+  Timer side;
+  for (uint64_t i = 0; i < n; ++i) {
+    sketch.add(keys[i]);
+    summary.add(keys[i]);
+  }
+  report("CMS + StreamSummary", "add", side.ns_per(n));
+
+  if (top.topk().size() != k) {
+    std::cout << "topk mismatch" << std::endl;
+  }
+}
+
+
+template <class K>
+void bench_dyadic(const std::string &name, const uint64_t n) {
+  const std::vector<uint64_t> keys = make_keys(n, 19);
+  DyadicCountMin<K> d(0.001, 0.01, 1u);
+  const uint64_t queries = std::min(n, (uint64_t)100000);
+  uint64_t sum = 0;
+
+  Timer add;
+  for (uint64_t i = 0; i < n; ++i) {
+    d.add((K)keys[i]);
+  }
+  report(name, "add", add.ns_per(n));
+
+  Timer range;
+  for (uint64_t i = 0; i < queries; ++i) {
+    sum += d.range_count((K)(keys[i] / 2), (K)keys[i]);
+  }
+  report(name, "range", range.ns_per(queries));
+
+  Timer quantile;
+  for (uint64_t i = 0; i < queries; ++i) {
+    sum += d.quantile((double)i / queries);
+  }
+  report(name, "quantile", quantile.ns_per(queries));
+
+  std::cout << std::left << std::setw(28) << name << std::setw(10) << "memory"
+            << d.memory() / 1024 << " KB (" << d.sketched_levels() << " sketched levels)" 
+            << (sum ? "" : ", empty sketch") << std::endl;
+}
+
+
+void bench_count_sketch(const std::string &name, const uint64_t n, const double epsilon, const double delta) {
+  const std::vector<uint64_t> keys = make_keys(n, 23);
+  std::vector<int32_t> out(n);
+  CountSketch<uint64_t> a(epsilon, delta, 1u);
+  CountSketch<uint64_t> b(epsilon, delta, 1u);
+  int64_t sum = 0;
+
+  Timer add;
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(keys[i]);
+  }
+  report(name, "add", add.ns_per(n));
+
+  Timer add_batch;
+  b.add_batch(&keys[0], n);
+  report(name + " (batch)", "add", add_batch.ns_per(n));
+
+  Timer estimate;
+  for (uint64_t i = 0; i < n; ++i) {
+    sum += a.estimate(keys[i]);
+  }
+  report(name, "estimate", estimate.ns_per(n));
+
+  Timer estimate_batch;
+  b.estimate_batch(&keys[0], n, &out[0]);
+  report(name + " (batch)", "estimate", estimate_batch.ns_per(n));
+
+  Timer f2;
+  const double moment = a.f2();
+  report(name, "f2", f2.ns_per(1));
+
+  for (uint64_t i = 0; i < n; ++i) {
+    sum -= out[i];
+  }
+  std::cout << std::left << std::setw(28) << name << std::setw(10) << "memory"
+            << a.memory() / 1024 << " KB" << (sum || moment <= 0.0 ? ", batch mismatch" : "") << std::endl;
+}
+
+
+// one counter policy at a shape that fits in L2 with 8 bit counters
+template <class C>
+void bench_policy(const std::string &name, const uint64_t n) {
+  const std::vector<uint64_t> keys = make_keys(n, 29);
+  CountMinSketch<uint64_t, uint64_t, C> a =
+    CountMinSketch<uint64_t, uint64_t, C>::from_error(0.0001, 0.01, 1u);
+  std::vector<typename CountMinSketch<uint64_t, uint64_t, C>::value_type> out(n);
+  double err = 0.0;
+
+  Timer add;
+  a.add_batch(&keys[0], n);
+  report(name + " (batch)", "add", add.ns_per(n));
+
+  Timer estimate;
+  a.estimate_batch(&keys[0], n, &out[0]);
+  report(name + " (batch)", "estimate", estimate.ns_per(n));
+
+  // relative error of the heaviest key, 0
+  for (uint64_t i = 0; i < n; ++i) {
+    err += !keys[i];
+  }
+  err = std::fabs((double)a.estimate(0) - err) / err;
+  std::cout << std::left << std::setw(28) << name << std::setw(10) << "memory"
+            << a.memory() / 1024 << " KB, " << std::setprecision(3) << 100.0 * err 
+            << "% off on the top key" << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  const uint64_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+
+  std::cout << n << " keys, " << (cms_has_avx2() ? "AVX2" : "scalar") << " batch kernels" << std::endl;
+  bench_batch<uint32_t>("CMS 32 bit 5 MB", n, 0.00001, 0.01);
+  bench_batch<uint64_t>("CMS 64 bit 15 MB", n, 0.00001, 0.001);
+  bench_batch<uint32_t>("CMS 32 bit 54 KB", n, 0.001, 0.01);
+
+  std::cout << std::endl << "1000 shards, 5 rows x 27183" << std::endl;
+  bench_merge(1000);
+
+  std::cout << std::endl << n << " keys, top 100" << std::endl;
+  bench_topk(n, 100);
+
+  std::cout << std::endl << n << " keys, dyadic, epsilon 0.001" << std::endl;
+  bench_dyadic<uint32_t>("Dyadic CMS 32 bit keys", n);
+  bench_dyadic<uint64_t>("Dyadic CMS 64 bit keys", n);
+
+  std::cout << std::endl << n << " keys, count sketch" << std::endl;
+  bench_count_sketch("CS 32 bit 5 MB", n, 0.0078, 0.01);
+
+  std::cout << std::endl << n << " keys, counter policies, 5 rows x 27183" << std::endl;
+  bench_policy<uint32_t>("CMS 32 bit", n);
+  bench_policy<CmsSaturating<uint16_t> >("CMS 16 bit sat", n);
+  bench_policy<CmsSaturating<uint8_t> >("CMS 8 bit sat", n);
+  bench_policy<CmsMorris<> >("CMS 8 bit Morris", n);
+
+  const uint32_t threads = argc > 2 ? atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+  std::cout << std::endl << n << " updates, 5 rows x 27183, shared by up to " << threads << " threads" << std::endl;
+  bench_concurrent(n, threads);
+
+  return (0);
+}
@@ -50,39 +50,909 @@
 #define __COUNT_MIN_SKETCH__
 
 #include <vector>
+#include <algorithm>
 #include <limits>
+#include <cmath>
+#include <string>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
 #include <stdint.h>
 
-template <class S, class T>
+#if defined(__x86_64__)
+#include <immintrin.h>
+// compile one function for AVX2 whatever the target of the rest, so it
+// can be picked at runtime (see cms_has_avx2)
+#define CMS_AVX2 __attribute__((target("avx2")))
+#endif
+
+#include "../hash/double_hash.hpp"
+
+
+// Number of keys the batched calls hash and prefetch before touching 
+// the counters
+const uint64_t CMS_BATCH_SIZE = 16;
+
+// true when the CPU running the program supports AVX2, checked once
+inline bool cms_has_avx2() {
+#if defined(__x86_64__)
+  static const bool ret = __builtin_cpu_supports("avx2");
+
+  return (ret);
+#else
+  return (false);
+#endif
+}
+
+// Map the high 32 bits of a hash onto [0, width) with a multiply-shift,
+// which the AVX2 kernels can do 4 at a time (width is at most 2^32)
+inline uint64_t cms_column(const uint64_t h, const uint64_t width) {
+  return (((h >> 32) * width) >> 32);
+}
+
+
+// (i^3 - i) / 6, the last term of DoubleHash::operator[]
+inline uint64_t cms_tetra(const uint64_t i) {
+  return ((i * i * i - i) / 6);
+}
+
+#if defined(__x86_64__)
+// store the first min(n, 4) lanes of v
+CMS_AVX2 inline void cms_store_avx2(uint64_t *dst, const __m256i v, const uint32_t n) {
+  if (n >= 4) {
+    _mm256_storeu_si256((__m256i *)dst, v);
+  } else {
+    uint64_t tmp[4];
+
+    _mm256_storeu_si256((__m256i *)tmp, v);
+    std::copy(tmp, tmp + n, dst);
+  }
+}
+
+// cms_offsets for rows i to i + 3 of a key at a time. AVX2 has no 64 bit
+// multiply, so i * h2 is built from 32 bit products, and the column from
+// the high half of each hash times the low 32 bits of width (so width 
+// must be below 2^32).
+CMS_AVX2 inline void cms_offsets_avx2(const uint64_t *h1, const uint64_t *h2, const uint64_t n,
+                                      const uint32_t depth, const uint64_t width, 
+                                      const uint64_t stride, uint64_t *off, uint64_t *sign) {
+  const __m256i w = _mm256_set1_epi64x(width);
+  const __m256i one = _mm256_set1_epi64x(1);
+
+  for (uint32_t i = 0; i < depth; i += 4) {
+    const __m256i lane = _mm256_setr_epi64x(i, i + 1, i + 2, i + 3);
+    const __m256i cube = _mm256_setr_epi64x(cms_tetra(i), cms_tetra(i + 1), 
+                                            cms_tetra(i + 2), cms_tetra(i + 3));
+    const __m256i start = _mm256_setr_epi64x(i * stride, (i + 1) * stride, 
+                                             (i + 2) * stride, (i + 3) * stride);
+      
+    for (uint64_t j = 0; j < n; ++j) {
+      const __m256i b = _mm256_set1_epi64x(h2[j]);
+      const __m256i ib = _mm256_add_epi64(_mm256_mul_epu32(lane, b), 
+                                          _mm256_slli_epi64(_mm256_mul_epu32(lane, _mm256_srli_epi64(b, 32)), 32));
+      const __m256i h = _mm256_add_epi64(_mm256_add_epi64(_mm256_set1_epi64x(h1[j]), ib), cube);
+      const __m256i col = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(h, 32), w), 32);
+
+      cms_store_avx2(off + j * depth + i, _mm256_add_epi64(col, start), depth - i);
+      if (sign) {
+        cms_store_avx2(sign + j * depth + i, _mm256_and_si256(_mm256_srli_epi64(h, 31), one), depth - i);
+      }
+    }
+  }
+}
+#endif
+
+// The offsets from the first row of the depth counters of each of keys[0, n)
+// (at most CMS_BATCH_SIZE), key after key, in a table of rows stride
+// counters apart: i * stride + cms_column(h[i], width) for the DoubleHash
+// h of the key. With sign, also bit 31 of each h[i] (see CountSketch).
+template <class T>
+void cms_offsets(const T *keys, const uint64_t n, const uint32_t seed, const uint32_t depth,
+                 const uint64_t width, const uint64_t stride, uint64_t *off, 
+                 uint64_t *sign = NULL) {
+  uint64_t h1[CMS_BATCH_SIZE];
+  uint64_t h2[CMS_BATCH_SIZE];
+
+  for (uint64_t j = 0; j < n; ++j) {
+    const DoubleHash h(keys[j], seed);
+
+    h1[j] = h.h1();
+    h2[j] = h.h2();
+  }
+
+#if defined(__x86_64__)
+  // a width of 2^32 does not fit the 32 bit multiply of the kernel
+  if (cms_has_avx2() && width <= 0xffffffffULL) {
+    cms_offsets_avx2(h1, h2, n, depth, width, stride, off, sign);
+    return;
+  }
+#endif
+  for (uint64_t j = 0; j < n; ++j) {
+    const DoubleHash h = DoubleHash::from_halves(h1[j], h2[j]);
+
+    for (uint32_t i = 0; i < depth; ++i) {
+      off[j * depth + i] = i * stride + cms_column(h[i], width);
+      if (sign) {
+        sign[j * depth + i] = (h[i] >> 31) & 1;
+      }
+    }
+  }
+}
+
+
+// Wire format of a serialized CountMinSketch, in host byte order: this
+// header, then the width counters of each row in turn (without the row
+// padding).
+const char CMS_WIRE_MAGIC[4] = {'C', 'M', 'S', 'K'};
+const uint16_t CMS_WIRE_VERSION = 1;
+
+// CountMinWireHeader::flags
+const uint8_t CMS_WIRE_DOUBLE_HASH = 1;
+const uint8_t CMS_WIRE_CONSERVATIVE = 2;
+const uint8_t CMS_WIRE_SIGNED = 4;
+// counter policy bits, see CmsMorris
+const uint8_t CMS_WIRE_POLICY = 0xf8;
+const uint8_t CMS_WIRE_APPROXIMATE = 8;
+
+struct CountMinWireHeader {
+  char magic[4];
+  uint16_t version;
+  uint8_t counter_bytes;
+  uint8_t flags;
+  uint32_t depth;
+  uint32_t seed;
+  uint64_t width;
+  // sum of all counts added
+  uint64_t total;
+};
+
+static_assert(sizeof(CountMinWireHeader) == 32, "CountMinWireHeader must be 32 bytes");
+
+
+// xorshift64* step, the random source of the approximate counters
+inline uint64_t cms_rand(uint64_t &state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+
+  return (state * 0x2545f4914f6cdd1dULL);
+}
+
+
+// Counter policies. The counter type C of a CountMinSketch is either an
+// integer type, counted as by CmsCounter<C>, or a policy: a struct that
+// names the type stored in the table (cell) and the type of counts and
+// estimates (value), and says how a cell is raised by one (increment,
+// the hot loop of add_batch, which should not branch) or by any count
+// (add), read (value_of, which must not decrease as the cell grows, so
+// the smallest cell of a key still gives its estimate) and merged with
+// another. Policies with RANDOM set are passed 64 random bits, the same
+// for every row of a key, so that the rows of a key no other key hits
+// stay equal. WIRE_FLAGS tells serialized sketches of other policies 
+// with the same cells apart (see CountMinWireHeader).
+
+// Plain integer counters: adds wrap at the maximum of C, merges of
+// unsigned counters saturate there
+template <class C>
+struct CmsCounter {
+  typedef C cell;
+  typedef C value;
+
+  static const bool RANDOM = false;
+  static const uint8_t WIRE_FLAGS = 0;
+
+  static inline cell increment(const cell c, const uint64_t) {
+    return (c + 1);
+  }
+
+  static inline cell add(const cell c, const value count, const uint64_t) {
+    return (c + count);
+  }
+
+  static inline value value_of(const cell c) {
+    return (c);
+  }
+
+  static inline cell merge(const cell a, const cell b, const uint64_t) {
+    if (std::is_unsigned<C>::value) {
+      const cell sum = a + b;
+
+      return (sum < b ? std::numeric_limits<C>::max() : sum);
+    }
+
+    return (a + b);
+  }
+};
+
+// Unsigned counters that stop at their maximum instead of wrapping, so
+// an 8 or 16 bit sketch never underestimates, it only loses resolution
+// above 255 or 65535
+template <class U>
+struct CmsSaturating {
+  static_assert(std::is_unsigned<U>::value, "saturating counters must be unsigned");
+
+  typedef U cell;
+  typedef U value;
+
+  static const bool RANDOM = false;
+  static const uint8_t WIRE_FLAGS = 0;
+
+  static inline cell increment(const cell c, const uint64_t) {
+    return (c + (c != std::numeric_limits<U>::max()));
+  }
+
+  static inline cell add(const cell c, const value count, const uint64_t r) {
+    return (CmsCounter<U>::merge(c, count, r));
+  }
+
+  static inline value value_of(const cell c) {
+    return (c);
+  }
+
+  static inline cell merge(const cell a, const cell b, const uint64_t r) {
+    return (CmsCounter<U>::merge(a, b, r));
+  }
+};
+
+// Approximate counters in one byte, as described in "Approximate 
+// Counting: A Detailed Analysis" by P. Flajolet (after R. Morris). A 
+// cell c stands for a * ((1 + 1/a)^c - 1) with a = 2^Shift, and one more
+// count raises it with probability (1 + 1/a)^-c, which keeps the value
+// unbiased. Larger Shift trades range for accuracy: the relative 
+// standard error is about sqrt(1 / 2a), and 255 reaches a * (1 + 1/a)^255
+// (8.2e7 for the default Shift of 4, 18% error). Estimates are no longer
+// upper bounds of the true counts.
+template <uint32_t Shift = 4>
+struct CmsMorris {
+  static_assert(Shift < 16, "Shift must fit in the wire flags");
+
+  typedef uint8_t cell;
+  typedef uint64_t value;
+
+  static const bool RANDOM = true;
+  static const uint8_t WIRE_FLAGS = CMS_WIRE_APPROXIMATE | (Shift << 4);
+
+  static inline cell increment(const cell c, const uint64_t r) {
+    return (c + ((r <= tables().step[c]) & (c != 255)));
+  }
+
+  static inline cell add(const cell c, const value count, const uint64_t r) {
+    return (count == 1 ? increment(c, r) : raise(c, tables().exact[c] + count, r));
+  }
+
+  static inline value value_of(const cell c) {
+    return (tables().value[c]);
+  }
+
+  static inline cell merge(const cell a, const cell b, const uint64_t r) {
+    return (raise(std::max(a, b), tables().exact[a] + tables().exact[b], r));
+  }
+
+private:
+
+  struct Tables {
+    Tables() {
+      const double base = 1.0 + 1.0 / (1 << Shift);
+
+      for (uint32_t c = 0; c < 256; ++c) {
+        const double p = std::pow(base, -(double)c);
+
+        exact[c] = (1 << Shift) * (std::pow(base, (double)c) - 1.0);
+        value[c] = (uint64_t)(exact[c] + 0.5);
+        // the increment probability as a threshold on 64 random bits
+        step[c] = p >= 1.0 ? std::numeric_limits<uint64_t>::max() : (uint64_t)std::ldexp(p, 64);
+      }
+    }
+
+    double exact[256];
+    uint64_t value[256];
+    uint64_t step[256];
+  };
+
+  static const Tables &tables() {
+    static const Tables ret;
+
+    return (ret);
+  }
+
+  // the cell from c up for a value of target, rounded up or down at 
+  // random so that it is right on average
+  static cell raise(cell c, const double target, const uint64_t r) {
+    const Tables &t = tables();
+
+    while (c < 255 && t.exact[c + 1] <= target) {
+      ++c;
+    }
+    if (c == 255) {
+      return (c);
+    }
+
+    const double p = (target - t.exact[c]) / (t.exact[c + 1] - t.exact[c]);
+
+    return (c + ((r >> 11) * (1.0 / 9007199254740992.0) < p));
+  }
+};
+
+// The policy of a counter type C (see above)
+template <class C>
+struct cms_counter {
+  typedef typename std::conditional<std::is_arithmetic<C>::value, CmsCounter<C>, C>::type type;
+};
+
+
+// Number of counters per row for an error of at most epsilon times the
+// total count (with probability 1 - delta, see cms_depth)
+inline uint64_t cms_width(const double epsilon) {
+  assert(epsilon > 0.0 && epsilon < 1.0);
+
+  return ((uint64_t)std::ceil(std::exp(1.0) / epsilon));
+}
+
+// Number of rows for the error bound to hold with probability 1 - delta
+inline uint32_t cms_depth(const double delta) {
+  assert(delta > 0.0 && delta < 1.0);
+
+  return ((uint32_t)std::ceil(std::log(1.0 / delta)));
+}
+
+
+// S is the type of the hash functions and C the type of the counters, 
+// or a counter policy (see CmsSaturating, CmsMorris). The counters are
+// stored in one buffer, row after row, with every row starting on a 
+// cache line.
+template <class S, class T, class C = S>
 class CountMinSketch {
 public:
   typedef S (*hash_function)(const T &s);
-    
-    
+  typedef typename cms_counter<C>::type policy;
+  // stored counter, and count / estimate
+  typedef typename policy::cell cell_type;
+  typedef typename policy::value value_type;
+
+  // counters per cache line
+  static const uint64_t LINE = 64 / sizeof(cell_type);
+
+  // one row per hash function, with one counter for every value of S (S
+  // must be narrower than 64 bits)
   CountMinSketch(const std::vector<hash_function> &hash_list) : 
-    matrix_(hash_list.size(), std::vector<S>(std::numeric_limits<S>::max(), 0)), 
-    hash_list_(hash_list) {}
+    width_(full_range()),
+    depth_((uint32_t)hash_list.size()),
+    stride_(stride_for(width_)),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    hash_list_(hash_list),
+    k_(0),
+    seed_(0),
+    total_(0),
+    conservative_(false),
+    rand_(seed_rand(seed_)) {}
+
+  // depth rows whose indices are all derived from a single 128 bit
+  // MurmurHash3 of the key (see double_hash.hpp)
+  CountMinSketch(const uint32_t depth, const uint32_t seed = 0) : 
+    width_(full_range()),
+    depth_(depth),
+    stride_(stride_for(width_)),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    k_(depth),
+    seed_(seed),
+    total_(0),
+    conservative_(false),
+    rand_(seed_rand(seed_))
+  {
+    assert(depth);
+    assert(width_ <= ((uint64_t)1 << 32));
+  }
+
+  // (epsilon, delta) would otherwise convert to (depth, seed); use 
+  // from_error()
+  CountMinSketch(const double epsilon, const double delta) = delete;
+
+  // Size the sketch so that, with probability 1 - delta, a count is 
+  // overestimated by at most epsilon times the total count. Indices are
+  // derived from one 128 bit MurmurHash3 of the key, as above.
+  static CountMinSketch<S,T,C> from_error(const double epsilon, const double delta, const uint32_t seed = 0) {
+    return (CountMinSketch<S,T,C>(cms_width(epsilon), cms_depth(delta), seed));
+  }
+
+  CountMinSketch(const CountMinSketch<S,T,C> &s) :
+    width_(s.width_),
+    depth_(s.depth_),
+    stride_(s.stride_),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    hash_list_(s.hash_list_),
+    k_(s.k_),
+    seed_(s.seed_),
+    total_(s.total_),
+    conservative_(s.conservative_),
+    rand_(s.rand_)
+  {
+    std::copy(s.row(0), s.row(0) + depth_ * stride_, row(0));
+  }
+
+  // the buffer is over-allocated and aligned by hand, so copies must go 
+  // through row() rather than copying the vector verbatim
+  CountMinSketch<S,T,C> &operator=(const CountMinSketch<S,T,C> &s) {
+    if (this != &s) {
+      width_ = s.width_;
+      depth_ = s.depth_;
+      stride_ = s.stride_;
+      table_.assign(depth_ * stride_ + LINE - 1, 0);
+      hash_list_ = s.hash_list_;
+      k_ = s.k_;
+      seed_ = s.seed_;
+      total_ = s.total_;
+      conservative_ = s.conservative_;
+      rand_ = s.rand_;
+      std::copy(s.row(0), s.row(0) + depth_ * stride_, row(0));
+    }
+
+    return (*this);
+  }
         
-  void add(const T &s) {
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      ++matrix_[i][(*hash_list_[i])(s)];
+  // Add count occurrences of s. With conservative update on, counters
+  // are only raised as far as the new estimate of s, which leaves the 
+  // others unchanged and reduces the overestimate of every key.
+  void add(const T &s, const value_type count = 1) {
+    add(s, hash(s), count);
+  }
+
+  // Number of times s was added: never less than the true count, and with
+  // probability 1 - delta at most epsilon * total() more (see cms_width)
+  value_type estimate(const T &s) const {
+    return (estimate(s, hash(s)));
+  }
+
+  // The hash of s that add() and estimate() below take, for callers that
+  // use it for something else too (see TopK) and so only hash s once
+  DoubleHash hash(const T &s) const {
+    return (k_ ? DoubleHash(s, seed_) : DoubleHash());
+  }
+
+  // add() for s hashed with hash(s); returns the new estimate of s
+  value_type add(const T &s, const DoubleHash &h, const value_type count) {
+    const uint64_t r = random();
+
+    total_ += count;
+    if (conservative_) {
+      const cell_type target = policy::add(min_cell(s, h), count, r);
+
+      for (uint32_t i = 0; i < depth_; ++i) {
+        cell_type &c = row(i)[index(s, h, i)];
+
+        c = std::max(c, target);
+      }
+      return (policy::value_of(target));
+    }
+
+    cell_type ret = std::numeric_limits<cell_type>::max();
+    for (uint32_t i = 0; i < depth_; ++i) {
+      cell_type &c = row(i)[index(s, h, i)];
+
+      c = policy::add(c, count, r);
+      ret = std::min(ret, c);
     }
+
+    return (policy::value_of(ret));
+  }
+
+  // estimate() for s hashed with hash(s)
+  value_type estimate(const T &s, const DoubleHash &h) const {
+    return (policy::value_of(min_cell(s, h)));
   }
     
   bool exists(const T &s) const {
-    for (uint32_t i = 0; i < hash_list_.size(); ++i) {
-      if (!matrix_[i][(*hash_list_[i])(s)]) {
+    const DoubleHash h = hash(s);
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      if (!row(i)[index(s, h, i)]) {
 	return (false);
       }
     }
     
     return (true);
   }
+
+  // Add each of keys[0, n) once. A block of CMS_BATCH_SIZE keys is 
+  // hashed, the offsets of all of its counters are computed (4 rows at a
+  // time with AVX2, when the CPU has it) and prefetched, and only then 
+  // are the counters incremented, so their cache misses overlap.
+  void add_batch(const T *keys, const uint64_t n) {
+    if (!k_ || conservative_) {
+      for (uint64_t j = 0; j < n; ++j) {
+        add(keys[j]);
+      }
+      return;
+    }
+
+    std::vector<uint64_t> off(CMS_BATCH_SIZE * depth_);
+    cell_type *base = row(0);
+
+    for (uint64_t b = 0; b < n; b += CMS_BATCH_SIZE) {
+      const uint64_t len = std::min(CMS_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &off[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        const uint64_t r = random();
+
+        for (uint32_t i = 0; i < depth_; ++i) {
+          cell_type &c = base[off[j * depth_ + i]];
+
+          c = policy::increment(c, r);
+        }
+      }
+    }
+    total_ += n;
+  }
+
+  // estimate() of each of keys[0, n) into out[0, n), hashing and 
+  // prefetching as add_batch. With AVX2 and 32 or 64 bit unsigned 
+  // counters, the counters of 4 rows are gathered and reduced at once.
+  void estimate_batch(const T *keys, const uint64_t n, value_type *out) const {
+    if (!k_) {
+      for (uint64_t j = 0; j < n; ++j) {
+        out[j] = estimate(keys[j]);
+      }
+      return;
+    }
+
+    std::vector<uint64_t> off(CMS_BATCH_SIZE * depth_);
+#if defined(__x86_64__)
+    const bool gather = cms_has_avx2() && std::is_unsigned<cell_type>::value && 
+                        (sizeof(cell_type) == 4 || sizeof(cell_type) == 8);
+#endif
+
+    for (uint64_t b = 0; b < n; b += CMS_BATCH_SIZE) {
+      const uint64_t len = std::min(CMS_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &off[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+#if defined(__x86_64__)
+        if (gather) {
+          out[b + j] = policy::value_of(min_avx2(&off[j * depth_]));
+          continue;
+        }
+#endif
+        out[b + j] = policy::value_of(min_scalar(&off[j * depth_]));
+      }
+    }
+  }
+
+  std::vector<value_type> estimate_batch(const std::vector<T> &keys) const {
+    std::vector<value_type> ret(keys.size());
+
+    if (keys.size()) {
+      estimate_batch(&keys[0], keys.size(), &ret[0]);
+    }
+
+    return (ret);
+  }
+
+  void clear() {
+    std::fill(table_.begin(), table_.end(), 0);
+    total_ = 0;
+  }
+
+  // Conservative update (off by default) keeps the same error bound but
+  // overestimates far less in practice, so the same accuracy needs a
+  // narrower sketch. It only works for counts that are never removed.
+  void set_conservative(const bool conservative) {
+    conservative_ = conservative;
+  }
+
+  bool conservative() const {
+    return (conservative_);
+  }
+
+  // sum of all counts added
+  uint64_t total() const {
+    return (total_);
+  }
+
+  // counters per row
+  uint64_t width() const {
+    return (width_);
+  }
+
+  // number of rows
+  uint32_t depth() const {
+    return (depth_);
+  }
+
+  // bytes used by the counters
+  uint64_t memory() const {
+    return (depth_ * stride_ * sizeof(cell_type));
+  }
+
+  // True when o has the same shape and hashing, so that counter (i, j)
+  // counts the same keys in both sketches
+  bool compatible(const CountMinSketch<S,T,C> &o) const {
+    return (width_ == o.width_ && depth_ == o.depth_ && k_ == o.k_ && 
+            seed_ == o.seed_ && hash_list_ == o.hash_list_);
+  }
+
+  // Add every count of o, as if its keys had been added here. Unsigned
+  // counters saturate at their maximum rather than wrap. Returns false, changing
+  // nothing, if the sketches are not compatible.
+  bool merge(const CountMinSketch<S,T,C> &o) {
+    if (!compatible(o)) {
+      return (false);
+    }
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      merge_row(row(i), (const char *)o.row(i));
+    }
+    total_ += o.total_;
+
+    return (true);
+  }
+
+  // The sketch in the wire format (CountMinWireHeader)
+  std::string serialize() const {
+    std::string ret(sizeof(CountMinWireHeader) + depth_ * width_ * sizeof(cell_type), 0);
+    const CountMinWireHeader h = header();
+    char *p = &ret[0];
+
+    memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+    for (uint32_t i = 0; i < depth_; ++i) {
+      memcpy(p, row(i), width_ * sizeof(cell_type));
+      p += width_ * sizeof(cell_type);
+    }
+
+    return (ret);
+  }
+
+  // Merge a serialized sketch straight from its wire format, with no 
+  // intermediate sketch. Returns false, changing nothing, if data is not
+  // a serialized sketch compatible with this one (for hash_list sketches
+  // only the number of rows can be checked).
+  bool merge(const char *data, const uint64_t len) {
+    CountMinWireHeader h;
+
+    if (!wire_header(data, len, h) || !same_shape(h)) {
+      return (false);
+    }
+
+    data += sizeof(h);
+    for (uint32_t i = 0; i < depth_; ++i) {
+      merge_row(row(i), data + i * width_ * sizeof(cell_type));
+    }
+    total_ += h.total;
+
+    return (true);
+  }
+
+  bool merge(const std::string &data) {
+    return (merge(data.data(), data.size()));
+  }
+
+  // Replace this sketch with a serialized one, taking its shape and seed.
+  // A hash_list sketch can only be replaced by one with as many rows and
+  // the same width. Returns false, changing nothing, if data is invalid.
+  bool deserialize(const char *data, const uint64_t len) {
+    CountMinWireHeader h;
+
+    if (!wire_header(data, len, h)) {
+      return (false);
+    }
+    if (!(h.flags & CMS_WIRE_DOUBLE_HASH) && !same_shape(h)) {
+      return (false);
+    }
+    if ((h.flags & CMS_WIRE_DOUBLE_HASH) && (!h.depth || !h.width || h.width > ((uint64_t)1 << 32))) {
+      return (false);
+    }
+
+    if (h.flags & CMS_WIRE_DOUBLE_HASH) {
+      hash_list_.clear();
+    }
+    width_ = h.width;
+    depth_ = h.depth;
+    stride_ = stride_for(width_);
+    table_.assign(depth_ * stride_ + LINE - 1, 0);
+    total_ = 0;
+    k_ = (h.flags & CMS_WIRE_DOUBLE_HASH) ? depth_ : 0;
+    seed_ = h.seed;
+    conservative_ = h.flags & CMS_WIRE_CONSERVATIVE;
+
+    return (merge(data, len));
+  }
+
+  bool deserialize(const std::string &data) {
+    return (deserialize(data.data(), data.size()));
+  }
     
 private:
+
+  // width columns by depth rows, for from_error()
+  CountMinSketch(const uint64_t width, const uint32_t depth, const uint32_t seed) :
+    width_(width),
+    depth_(depth),
+    stride_(stride_for(width_)),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    k_(depth_),
+    seed_(seed),
+    total_(0),
+    conservative_(false),
+    rand_(seed_rand(seed_))
+  {
+    assert(width_ <= ((uint64_t)1 << 32));
+  }
+
+  static uint64_t full_range() {
+    assert(sizeof(S) < sizeof(uint64_t));
+    return ((uint64_t)std::numeric_limits<S>::max() + 1);
+  }
+
+  // row length rounded up to whole cache lines
+  static uint64_t stride_for(const uint64_t width) {
+    return ((width + LINE - 1) / LINE * LINE);
+  }
+
+  inline uint64_t index(const T &s, const DoubleHash &h, const uint32_t i) const {
+    if (k_) {
+      return (cms_column(h[i], width_));
+    }
+
+    return ((*hash_list_[i])(s));
+  }
+
+  // Offsets from row(0) of the depth_ counters of each of keys[0, n),
+  // key after key, prefetched
+  void hash_batch(const T *keys, const uint64_t n, uint64_t *off) const {
+    cms_offsets(keys, n, seed_, depth_, width_, stride_, off);
+
+    const cell_type *base = row(0);
+    for (uint64_t i = 0; i < n * depth_; ++i) {
+      __builtin_prefetch(base + off[i]);
+    }
+  }
+
+  CountMinWireHeader header() const {
+    CountMinWireHeader ret;
+
+    memset(&ret, 0, sizeof(ret));
+    memcpy(ret.magic, CMS_WIRE_MAGIC, sizeof(ret.magic));
+    ret.version = CMS_WIRE_VERSION;
+    ret.counter_bytes = sizeof(cell_type);
+    ret.flags = (k_ ? CMS_WIRE_DOUBLE_HASH : 0) | (conservative_ ? CMS_WIRE_CONSERVATIVE : 0) |
+                (std::is_signed<cell_type>::value ? CMS_WIRE_SIGNED : 0) | policy::WIRE_FLAGS;
+    ret.depth = depth_;
+    ret.seed = seed_;
+    ret.width = width_;
+    ret.total = total_;
+
+    return (ret);
+  }
+
+  // read and check the header of a serialized sketch with our counters
+  static bool wire_header(const char *data, const uint64_t len, CountMinWireHeader &h) {
+    if (len < sizeof(h)) {
+      return (false);
+    }
+    memcpy(&h, data, sizeof(h));
+
+    return (!memcmp(h.magic, CMS_WIRE_MAGIC, sizeof(h.magic)) && h.version == CMS_WIRE_VERSION &&
+            h.counter_bytes == sizeof(cell_type) && 
+            !(h.flags & CMS_WIRE_SIGNED) == !std::is_signed<cell_type>::value &&
+            (h.flags & CMS_WIRE_POLICY) == policy::WIRE_FLAGS &&
+            h.width && h.width <= (len - sizeof(h)) / sizeof(cell_type) &&
+            len == sizeof(h) + h.depth * h.width * sizeof(cell_type));
+  }
+
+  // true when a sketch with header h counts the same keys in each counter
+  bool same_shape(const CountMinWireHeader &h) const {
+    return (h.width == width_ && h.depth == depth_ && h.seed == seed_ &&
+            !(h.flags & CMS_WIRE_DOUBLE_HASH) == !k_);
+  }
+
+  // policy::merge of src into dst over a row. src may be unaligned, so 
+  // it is read with memcpy (which compiles to a plain load), and for 
+  // integer counters the loop vectorizes.
+  void merge_row(cell_type *dst, const char *src) {
+    for (uint64_t j = 0; j < width_; ++j) {
+      cell_type v;
+
+      memcpy(&v, src + j * sizeof(cell_type), sizeof(cell_type));
+      dst[j] = policy::merge(dst[j], v, random());
+    }
+  }
+
+  // smallest counter of s
+  inline cell_type min_cell(const T &s, const DoubleHash &h) const {
+    cell_type ret = row(0)[index(s, h, 0)];
+
+    for (uint32_t i = 1; i < depth_; ++i) {
+      ret = std::min(ret, row(i)[index(s, h, i)]);
+    }
+
+    return (ret);
+  }
+
+  // smallest of the depth_ counters at off
+  inline cell_type min_scalar(const uint64_t *off) const {
+    const cell_type *base = row(0);
+    cell_type ret = base[off[0]];
+
+    for (uint32_t i = 1; i < depth_; ++i) {
+      ret = std::min(ret, base[off[i]]);
+    }
+
+    return (ret);
+  }
+
+#if defined(__x86_64__)
+  // min_scalar, gathering 4 rows at a time (cells are 32 or 64 bit unsigned)
+  CMS_AVX2 cell_type min_avx2(const uint64_t *off) const {
+    const cell_type *base = row(0);
+    uint32_t i = 0;
+    cell_type ret = std::numeric_limits<cell_type>::max();
+
+    if (sizeof(cell_type) == 4) {
+      __m128i m = _mm_set1_epi32(-1);
+
+      for (; i + 4 <= depth_; i += 4) {
+        const __m256i idx = _mm256_loadu_si256((const __m256i *)(off + i));
+
+        m = _mm_min_epu32(m, _mm256_i64gather_epi32((const int *)base, idx, 4));
+      }
+      m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+      m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+      ret = (cell_type)(uint32_t)_mm_cvtsi128_si32(m);
+    } else {
+      // unsigned compare, as a signed compare with the sign bits flipped
+      const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+      __m256i m = _mm256_set1_epi64x(-1);
+      uint64_t tmp[4];
+
+      for (; i + 4 <= depth_; i += 4) {
+        const __m256i idx = _mm256_loadu_si256((const __m256i *)(off + i));
+        const __m256i v = _mm256_i64gather_epi64((const long long *)base, idx, 8);
+        const __m256i gt = _mm256_cmpgt_epi64(_mm256_xor_si256(m, sign), _mm256_xor_si256(v, sign));
+
+        m = _mm256_blendv_epi8(m, v, gt);
+      }
+      _mm256_storeu_si256((__m256i *)tmp, m);
+      ret = (cell_type)std::min(std::min(tmp[0], tmp[1]), std::min(tmp[2], tmp[3]));
+    }
+
+    for (; i < depth_; ++i) {
+      ret = std::min(ret, base[off[i]]);
+    }
+
+    return (ret);
+  }
+#endif
+
+  // random state of policies that need one, a fixed function of the seed
+  static uint64_t seed_rand(const uint32_t seed) {
+    return (((uint64_t)seed << 32) ^ 0x9e3779b97f4a7c15ULL);
+  }
+
+  // random bits for the policy, 0 (and no work) if it takes none
+  inline uint64_t random() {
+    return (policy::RANDOM ? cms_rand(rand_) : 0);
+  }
+
+  inline cell_type *row(const uint32_t i) {
+    return ((cell_type *)(((uintptr_t)table_.data() + 63) & ~(uintptr_t)63) + i * stride_);
+  }
+
+  inline const cell_type *row(const uint32_t i) const {
+    return (const_cast<CountMinSketch<S,T,C> *>(this)->row(i));
+  }
   
-  std::vector<std::vector<S> > matrix_;
+  uint64_t width_;
+  uint32_t depth_;
+  // counters from the start of one row to the next
+  uint64_t stride_;
+  std::vector<cell_type> table_;
   std::vector<hash_function> hash_list_;
+  // number of double hashed rows, 0 when hash_list_ is used
+  uint32_t k_;
+  uint32_t seed_;
+  uint64_t total_;
+  bool conservative_;
+  uint64_t rand_;
 };
 
 
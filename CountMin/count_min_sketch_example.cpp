@@ -81,6 +81,20 @@ int main () {
 
   std::cout << a.exists(b) << std::endl;
   
+  // 4 rows, indices derived from one 128 bit hash of the key
+  CountMinSketch<uint16_t, std::string>  c(4);
+  
+  std::cout << c.exists(b) << std::endl;
+
+  c.add(b);
+
+  std::cout << c.exists(b) << std::endl;
+
+  // weighted add, and the estimated count of b (4)
+  c.add(b, 3);
+
+  std::cout << c.estimate(b) << std::endl;
+
 
   return 0;
 }
@@ -0,0 +1,355 @@
+/*
+ * count_sketch.hpp
+ *
+ *
+ * Count Sketch Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __COUNT_SKETCH__
+#define __COUNT_SKETCH__
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include <type_traits>
+#include <stdint.h>
+
+#include "count_min_sketch.hpp"
+
+
+// Most rows a CountSketch may have (the estimates of all rows are kept
+// on the stack)
+const uint32_t CS_MAX_DEPTH = 64;
+
+// Median of v[0, n) (the upper one for even n), reordering v. 1, 3, 5, 7
+// and 9 values go through fixed selection networks (from N. Devillard,
+// "Fast median search: an ANSI C implementation"), which compile to
+// branch free min/max; larger n use nth_element.
+template <class V>
+inline V cs_median(V *v, const uint32_t n) {
+#define CS_SORT2(a, b) { const V lo = std::min(v[a], v[b]); v[b] = std::max(v[a], v[b]); v[a] = lo; }
+  switch (n) {
+  case 1:
+    return (v[0]);
+  case 3:
+    CS_SORT2(0, 1); CS_SORT2(1, 2); CS_SORT2(0, 1);
+    return (v[1]);
+  case 5:
+    CS_SORT2(0, 1); CS_SORT2(3, 4); CS_SORT2(0, 3);
+    CS_SORT2(1, 4); CS_SORT2(1, 2); CS_SORT2(2, 3);
+    CS_SORT2(1, 2);
+    return (v[2]);
+  case 7:
+    CS_SORT2(0, 5); CS_SORT2(0, 3); CS_SORT2(1, 6);
+    CS_SORT2(2, 4); CS_SORT2(0, 1); CS_SORT2(3, 5);
+    CS_SORT2(2, 6); CS_SORT2(2, 3); CS_SORT2(3, 6);
+    CS_SORT2(4, 5); CS_SORT2(1, 4); CS_SORT2(1, 3);
+    CS_SORT2(3, 4);
+    return (v[3]);
+  case 9:
+    CS_SORT2(1, 2); CS_SORT2(4, 5); CS_SORT2(7, 8);
+    CS_SORT2(0, 1); CS_SORT2(3, 4); CS_SORT2(6, 7);
+    CS_SORT2(1, 2); CS_SORT2(4, 5); CS_SORT2(7, 8);
+    CS_SORT2(0, 3); CS_SORT2(5, 8); CS_SORT2(4, 7);
+    CS_SORT2(3, 6); CS_SORT2(1, 4); CS_SORT2(2, 5);
+    CS_SORT2(4, 7); CS_SORT2(4, 2); CS_SORT2(6, 4);
+    CS_SORT2(4, 2);
+    return (v[4]);
+  default:
+    std::nth_element(v, v + n / 2, v + n);
+    return (v[n / 2]);
+  }
+#undef CS_SORT2
+}
+
+
+// Counters per row for an error of at most epsilon times the L2 norm of
+// the counts, with probability 15/16 per row: the error of a row has a
+// variance of at most the squared L2 norm over the width (Chebyshev)
+inline uint64_t cs_width(const double epsilon) {
+  assert(epsilon > 0.0 && epsilon < 1.0);
+
+  return ((uint64_t)std::ceil(16.0 / (epsilon * epsilon)));
+}
+
+// Rows for the median of the rows to meet that bound with probability
+// 1 - delta; always odd, so the median is one row. The median of d rows
+// is only off if (d + 1) / 2 of them are, which happens with probability
+// at most 2^d * 16^-((d + 1) / 2) = 2^-(d + 2).
+inline uint32_t cs_depth(const double delta) {
+  assert(delta > 0.0 && delta < 1.0);
+
+  const double d = std::ceil(std::log2(1.0 / delta)) - 2.0;
+
+  return ((d < 1.0 ? 1u : (uint32_t)d) | 1);
+}
+
+
+// Count Sketch, as introduced in "Finding Frequent Items in Data Streams"
+// by M. Charikar, K. Chen and M. Farach-Colton. Like CountMinSketch, each
+// row maps a key to one counter, but the key adds +count or -count to it
+// depending on a second hash, so the other keys in the counter cancel 
+// out on average. The estimate is the median over the rows of the signed
+// counter, and its error is bounded by the L2 norm of the counts rather 
+// than their sum, which is far tighter on skewed streams. Counts may be
+// negative (turnstile streams, e.g. inserts and deletes).
+//
+// C is the (signed) counter type. The counters share the layout of 
+// CountMinSketch (one buffer, rows starting on cache lines). Row i of a
+// key uses h[i] of one DoubleHash of the key: the column from its high
+// half (cms_column), the sign from bit 31. Batched calls use the same
+// kernels (see cms_offsets).
+template <class T, class C = int32_t>
+class CountSketch {
+public:
+
+  static_assert(std::is_signed<C>::value, "Count Sketch counters must be signed");
+
+  // counters per cache line
+  static const uint64_t LINE = 64 / sizeof(C);
+
+  // With probability 1 - delta, an estimate is off by at most epsilon 
+  // times the L2 norm of all counts (see cs_width, cs_depth)
+  CountSketch(const double epsilon, const double delta, const uint32_t seed = 0) :
+    width_(cs_width(epsilon)),
+    depth_(cs_depth(delta)),
+    stride_(stride_for(width_)),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    seed_(seed)
+  {
+    assert(width_ <= ((uint64_t)1 << 32));
+    assert(depth_ <= CS_MAX_DEPTH);
+  }
+
+  CountSketch(const uint64_t width, const uint32_t depth, const uint32_t seed) :
+    width_(width),
+    depth_(depth),
+    stride_(stride_for(width_)),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    seed_(seed)
+  {
+    assert(width_ && width_ <= ((uint64_t)1 << 32));
+    assert(depth_ && depth_ <= CS_MAX_DEPTH);
+  }
+
+  CountSketch(const CountSketch<T,C> &s) :
+    width_(s.width_),
+    depth_(s.depth_),
+    stride_(s.stride_),
+    table_(depth_ * stride_ + LINE - 1, 0),
+    seed_(s.seed_)
+  {
+    std::copy(s.row(0), s.row(0) + depth_ * stride_, row(0));
+  }
+
+  CountSketch<T,C> &operator=(const CountSketch<T,C> &s) {
+    if (this != &s) {
+      width_ = s.width_;
+      depth_ = s.depth_;
+      stride_ = s.stride_;
+      table_.assign(depth_ * stride_ + LINE - 1, 0);
+      seed_ = s.seed_;
+      std::copy(s.row(0), s.row(0) + depth_ * stride_, row(0));
+    }
+
+    return (*this);
+  }
+
+  // Add count (which may be negative) occurrences of s
+  void add(const T &s, const C count = 1) {
+    const DoubleHash h(s, seed_);
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      row(i)[cms_column(h[i], width_)] += signed_count(count, h[i] >> 31);
+    }
+  }
+
+  void remove(const T &s, const C count = 1) {
+    add(s, -count);
+  }
+
+  // Net number of times s was added, the median of its signed counters
+  C estimate(const T &s) const {
+    const DoubleHash h(s, seed_);
+    C v[CS_MAX_DEPTH];
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      v[i] = signed_count(row(i)[cms_column(h[i], width_)], h[i] >> 31);
+    }
+
+    return (cs_median(v, depth_));
+  }
+
+  // Add each of keys[0, n) once, hashing, computing the offsets and 
+  // signs of a block of keys and prefetching their counters before
+  // touching them, as CountMinSketch::add_batch
+  void add_batch(const T *keys, const uint64_t n) {
+    std::vector<uint64_t> off(CMS_BATCH_SIZE * depth_);
+    std::vector<uint64_t> sign(CMS_BATCH_SIZE * depth_);
+    C *base = row(0);
+
+    for (uint64_t b = 0; b < n; b += CMS_BATCH_SIZE) {
+      const uint64_t len = std::min(CMS_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &off[0], &sign[0]);
+      for (uint64_t i = 0; i < len * depth_; ++i) {
+        base[off[i]] += signed_count(1, sign[i]);
+      }
+    }
+  }
+
+  // estimate() of each of keys[0, n) into out[0, n), batched as add_batch
+  void estimate_batch(const T *keys, const uint64_t n, C *out) const {
+    std::vector<uint64_t> off(CMS_BATCH_SIZE * depth_);
+    std::vector<uint64_t> sign(CMS_BATCH_SIZE * depth_);
+    const C *base = row(0);
+    C v[CS_MAX_DEPTH];
+
+    for (uint64_t b = 0; b < n; b += CMS_BATCH_SIZE) {
+      const uint64_t len = std::min(CMS_BATCH_SIZE, n - b);
+
+      hash_batch(keys + b, len, &off[0], &sign[0]);
+      for (uint64_t j = 0; j < len; ++j) {
+        for (uint32_t i = 0; i < depth_; ++i) {
+          v[i] = signed_count(base[off[j * depth_ + i]], sign[j * depth_ + i]);
+        }
+        out[b + j] = cs_median(v, depth_);
+      }
+    }
+  }
+
+  std::vector<C> estimate_batch(const std::vector<T> &keys) const {
+    std::vector<C> ret(keys.size());
+
+    if (keys.size()) {
+      estimate_batch(&keys[0], keys.size(), &ret[0]);
+    }
+
+    return (ret);
+  }
+
+  // Estimate of the second frequency moment F2, the sum of the squared
+  // net counts of all keys (the square of their L2 norm): the median
+  // over the rows of the sum of squared counters, as in "The Space 
+  // Complexity of Approximating the Frequency Moments" by N. Alon, 
+  // Y. Matias and M. Szegedy
+  double f2() const {
+    double v[CS_MAX_DEPTH];
+
+    for (uint32_t i = 0; i < depth_; ++i) {
+      const C *r = row(i);
+      double sum = 0.0;
+
+      for (uint64_t j = 0; j < width_; ++j) {
+        sum += (double)r[j] * r[j];
+      }
+      v[i] = sum;
+    }
+
+    return (cs_median(v, depth_));
+  }
+
+  void clear() {
+    std::fill(table_.begin(), table_.end(), 0);
+  }
+
+  // counters per row
+  uint64_t width() const {
+    return (width_);
+  }
+
+  // number of rows
+  uint32_t depth() const {
+    return (depth_);
+  }
+
+  // bytes used by the counters
+  uint64_t memory() const {
+    return (depth_ * stride_ * sizeof(C));
+  }
+
+private:
+
+  // row length rounded up to whole cache lines
+  static uint64_t stride_for(const uint64_t width) {
+    return ((width + LINE - 1) / LINE * LINE);
+  }
+
+  // count, negated when the low bit of sign is set, without branching
+  static inline C signed_count(const C count, const uint64_t sign) {
+    const C m = -(C)(sign & 1);
+
+    return ((count ^ m) - m);
+  }
+
+  // Offsets from row(0) and signs of the depth_ counters of each of 
+  // keys[0, n), key after key, prefetched
+  void hash_batch(const T *keys, const uint64_t n, uint64_t *off, uint64_t *sign) const {
+    cms_offsets(keys, n, seed_, depth_, width_, stride_, off, sign);
+
+    const C *base = row(0);
+    for (uint64_t i = 0; i < n * depth_; ++i) {
+      __builtin_prefetch(base + off[i]);
+    }
+  }
+
+  inline C *row(const uint32_t i) {
+    return ((C *)(((uintptr_t)table_.data() + 63) & ~(uintptr_t)63) + i * stride_);
+  }
+
+  inline const C *row(const uint32_t i) const {
+    return (const_cast<CountSketch<T,C> *>(this)->row(i));
+  }
+
+  uint64_t width_;
+  uint32_t depth_;
+  uint64_t stride_;
+  std::vector<C> table_;
+  uint32_t seed_;
+};
+
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * dyadic_count_min.hpp
+ *
+ *
+ * Dyadic Count-Min Sketch Implementation
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __DYADIC_COUNT_MIN__
+#define __DYADIC_COUNT_MIN__
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <cmath>
+#include <cassert>
+#include <stdint.h>
+
+#include "count_min_sketch.hpp"
+
+
+// Count-Min over the dyadic decomposition of an integer key space, for
+// range counts and quantiles, as described in "An Improved Data Stream
+// Summary: The Count-Min Sketch and its Applications" by G. Cormode and
+// S. Muthukrishnan.
+//
+// Level l counts the prefixes key >> l, for l = 0 (the keys themselves)
+// up to BITS (a single prefix). Any range [lo, hi] is the union of at
+// most 2 * BITS dyadic intervals, one point query each, so a range count
+// overestimates by at most 2 * BITS * epsilon * total(). Levels with no
+// more prefixes than a row has counters are counted exactly.
+//
+// All levels live in one buffer. add() hashes the key once per sketched
+// level, computes and prefetches the offsets of every counter it will
+// touch, and only then increments them. Prefixes are hashed with a 64
+// bit mixer seeded per level rather than MurmurHash3, since keys are
+// integers.
+template <class K, class C = uint64_t>
+class DyadicCountMin {
+public:
+
+  static_assert(std::is_same<K, uint32_t>::value || std::is_same<K, uint64_t>::value,
+                "keys must be uint32_t or uint64_t");
+
+  static const uint32_t BITS = 8 * sizeof(K);
+  static const uint32_t LEVELS = BITS + 1;
+  static const uint64_t LINE = 64 / sizeof(C);
+
+  // Point queries of each level are within epsilon * total() with
+  // probability 1 - delta (see CountMinSketch::from_error())
+  DyadicCountMin(const double epsilon, const double delta, const uint32_t seed = 0) :
+    width_(cms_width(epsilon)),
+    depth_(cms_depth(delta)),
+    stride_((width_ + LINE - 1) / LINE * LINE),
+    sketched_(0),
+    seed_(seed),
+    total_(0)
+  {
+    assert(width_ <= ((uint64_t)1 << 32));
+
+    uint64_t size = 0;
+    for (uint32_t l = 0; l < LEVELS; ++l) {
+      offset_[l] = size;
+      if (BITS - l < 64 && ((uint64_t)1 << (BITS - l)) <= width_) {
+        // exact, one counter per prefix
+        size += (((uint64_t)1 << (BITS - l)) + LINE - 1) / LINE * LINE;
+      } else {
+        sketched_ = l + 1;
+        size += depth_ * stride_;
+      }
+    }
+    table_.assign(size + LINE - 1, 0);
+    offsets_.resize(sketched_ * depth_ + LEVELS - sketched_);
+  }
+
+  DyadicCountMin(const DyadicCountMin<K,C> &d) :
+    width_(d.width_),
+    depth_(d.depth_),
+    stride_(d.stride_),
+    sketched_(d.sketched_),
+    table_(d.table_.size(), 0),
+    offsets_(d.offsets_.size()),
+    seed_(d.seed_),
+    total_(d.total_)
+  {
+    std::copy(d.offset_, d.offset_ + LEVELS, offset_);
+    std::copy(d.base(), d.base() + table_.size() - (LINE - 1), base());
+  }
+
+  DyadicCountMin<K,C> &operator=(const DyadicCountMin<K,C> &d) {
+    if (this != &d) {
+      DyadicCountMin<K,C> tmp(d);
+
+      std::swap(width_, tmp.width_);
+      std::swap(depth_, tmp.depth_);
+      std::swap(stride_, tmp.stride_);
+      std::swap(sketched_, tmp.sketched_);
+      std::swap(offset_, tmp.offset_);
+      table_.swap(tmp.table_);
+      offsets_.swap(tmp.offsets_);
+      std::swap(seed_, tmp.seed_);
+      std::swap(total_, tmp.total_);
+    }
+
+    return (*this);
+  }
+
+  // Add count occurrences of key to every level
+  void add(const K key, const C count = 1) {
+    uint64_t *off = &offsets_[0];
+    uint64_t n = 0;
+    C *b = base();
+
+    for (uint32_t l = 0; l < sketched_; ++l) {
+      const DoubleHash h = hash(prefix(key, l), l);
+      const uint64_t o = offset_[l];
+
+      for (uint32_t i = 0; i < depth_; ++i) {
+        off[n++] = o + i * stride_ + cms_column(h[i], width_);
+      }
+    }
+    for (uint32_t l = sketched_; l < LEVELS; ++l) {
+      off[n++] = offset_[l] + prefix(key, l);
+    }
+
+    for (uint64_t i = 0; i < n; ++i) {
+      __builtin_prefetch(b + off[i]);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+      b[off[i]] += count;
+    }
+    total_ += count;
+  }
+
+  // estimated number of times key was added
+  C estimate(const K key) const {
+    return (point(0, key));
+  }
+
+  // Estimated number of keys added in [lo, hi], never less than the true
+  // count. O(BITS) point queries.
+  C range_count(const K lo, const K hi) const {
+    uint64_t a = lo;
+    uint64_t b = hi;
+    C ret = 0;
+
+    if (a > b) {
+      return (0);
+    }
+
+    // a and b are prefixes at level l; peel off the unaligned ends and
+    // move up until they meet
+    for (uint32_t l = 0; ; ++l) {
+      if (a & 1) {
+        ret += point(l, a);
+        if (a == b) {
+          return (ret);
+        }
+        ++a;
+      }
+      if (!(b & 1)) {
+        ret += point(l, b);
+        if (a == b) {
+          return (ret);
+        }
+        --b;
+      }
+      a >>= 1;
+      b >>= 1;
+    }
+  }
+
+  // Smallest key x whose estimated rank, range_count(0, x), is at least
+  // phi * total(), found top down with one point query per level
+  K quantile(const double phi) const {
+    assert(phi >= 0.0 && phi <= 1.0);
+
+    double rank = std::max(1.0, std::ceil(phi * total_));
+    uint64_t x = 0;
+
+    for (uint32_t l = BITS; l-- > 0; ) {
+      const C left = point(l, 2 * x);
+
+      x = 2 * x;
+      if (left < rank) {
+        rank -= left;
+        x += 1;
+      }
+    }
+
+    return ((K)x);
+  }
+
+  void clear() {
+    std::fill(table_.begin(), table_.end(), 0);
+    total_ = 0;
+  }
+
+  // sum of all counts added
+  uint64_t total() const {
+    return (total_);
+  }
+
+  // counters per row of a sketched level
+  uint64_t width() const {
+    return (width_);
+  }
+
+  // rows per sketched level
+  uint32_t depth() const {
+    return (depth_);
+  }
+
+  // number of levels (from 0) backed by a sketch rather than exact counters
+  uint32_t sketched_levels() const {
+    return (sketched_);
+  }
+
+  // bytes used by the counters
+  uint64_t memory() const {
+    return ((table_.size() - (LINE - 1)) * sizeof(C));
+  }
+
+private:
+
+  static inline uint64_t prefix(const uint64_t key, const uint32_t l) {
+    return (l < 64 ? key >> l : 0);
+  }
+
+  // MurmurHash3's 64 bit finalizer
+  static inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+
+    return (x);
+  }
+
+  inline DoubleHash hash(const uint64_t p, const uint32_t l) const {
+    const uint64_t h1 = mix(p ^ mix(((uint64_t)seed_ << 8) + l + 1));
+
+    return (DoubleHash::from_halves(h1, mix(h1 ^ 0x9e3779b97f4a7c15ULL)));
+  }
+
+  // estimated count of prefix p at level l
+  C point(const uint32_t l, const uint64_t p) const {
+    const C *b = base() + offset_[l];
+
+    if (l >= sketched_) {
+      return (b[p]);
+    }
+
+    const DoubleHash h = hash(p, l);
+    C ret = b[cms_column(h[0], width_)];
+
+    for (uint32_t i = 1; i < depth_; ++i) {
+      ret = std::min(ret, b[i * stride_ + cms_column(h[i], width_)]);
+    }
+
+    return (ret);
+  }
+
+  inline C *base() {
+    return ((C *)(((uintptr_t)table_.data() + 63) & ~(uintptr_t)63));
+  }
+
+  inline const C *base() const {
+    return (const_cast<DyadicCountMin<K,C> *>(this)->base());
+  }
+
+  uint64_t width_;
+  uint32_t depth_;
+  uint64_t stride_;
+  // levels [0, sketched_) are sketches, the rest exact
+  uint32_t sketched_;
+  // start of each level in the buffer
+  uint64_t offset_[LEVELS];
+  std::vector<C> table_;
+  // scratch for add()
+  std::vector<uint64_t> offsets_;
+  uint32_t seed_;
+  uint64_t total_;
+};
+
+
+#endif
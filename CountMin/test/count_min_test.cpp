@@ -0,0 +1,778 @@
+/*
+ * count_min_test.cpp
+ *
+ *
+ * Count-Min Sketch Test Program
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+
+#include "../count_min_sketch.hpp"
+#include "../concurrent_count_min_sketch.hpp"
+#include "../top_k.hpp"
+#include "../dyadic_count_min.hpp"
+#include "../count_sketch.hpp"
+#include "../../hash/MurmurHash3.hpp"
+
+
+#define CHECK(x)                                                        \
+  if (!(x)) {                                                           \
+    std::cout << __FILE__ << ":" << __LINE__ << " check failed: " #x << std::endl; \
+    exit(1);                                                            \
+  }
+
+
+template <uint32_t seed>
+uint16_t hash16(const std::string &s) {
+  uint32_t ret;
+  MurmurHash3_x86_32(s.c_str(), s.length(), seed, &ret);
+  
+  return ((uint16_t)ret);
+}
+
+std::string key(const uint64_t i) {
+  std::stringstream ss;
+  ss << "key-" << i;
+
+  return (ss.str());
+}
+
+
+void test_sizing() {
+  typedef CountMinSketch<uint64_t, std::string, uint32_t> Sketch;
+
+  // error bounds without a seed must not be taken as (depth, seed)
+  static_assert(!std::is_constructible<Sketch, double, double>::value, "");
+  static_assert(!std::is_constructible<Sketch, double, double, uint32_t>::value, "");
+  static_assert(std::is_constructible<Sketch, uint32_t, uint32_t>::value, "");
+
+  CountMinSketch<uint64_t, std::string, uint32_t> a =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.001, 0.01, 1u);
+
+  CHECK(a.width() == 2719);
+  CHECK(a.depth() == 5);
+  // rows are padded to whole cache lines
+  CHECK(a.memory() == 5 * 2720 * sizeof(uint32_t));
+  CHECK(a.memory() % 64 == 0);
+
+  CountMinSketch<uint64_t, std::string, uint8_t> b =
+    CountMinSketch<uint64_t, std::string, uint8_t>::from_error(0.01, 0.001, 1u);
+  CHECK(b.width() == 272);
+  CHECK(b.depth() == 7);
+  CHECK(b.memory() == 7 * 320);
+
+  std::vector<CountMinSketch<uint16_t, std::string>::hash_function> list;
+  list.push_back(hash16<1>);
+  list.push_back(hash16<2>);
+  CountMinSketch<uint16_t, std::string> c(list);
+  CHECK(c.width() == 65536);
+  CHECK(c.depth() == 2);
+}
+
+void test_counter_type() {
+  const uint64_t n = 1000;
+  std::vector<CountMinSketch<uint16_t, std::string, uint8_t>::hash_function> list;
+
+  list.push_back(hash16<1>);
+  list.push_back(hash16<2>);
+  list.push_back(hash16<3>);
+
+  // the counter type no longer follows the hash type
+  CountMinSketch<uint16_t, std::string, uint8_t> narrow(list);
+  CountMinSketch<uint16_t, std::string, uint64_t> wide =
+    CountMinSketch<uint16_t, std::string, uint64_t>::from_error(0.001, 0.001, 3u);
+  for (uint64_t i = 0; i < 256; ++i) {
+    narrow.add(key(0));
+    wide.add(key(0));
+  }
+  CHECK(!narrow.exists(key(0)));
+  CHECK(wide.exists(key(0)));
+
+  CountMinSketch<uint16_t, std::string, uint32_t> a =
+    CountMinSketch<uint16_t, std::string, uint32_t>::from_error(0.001, 0.01, 2u);
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i));
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(a.exists(key(i)));
+  }
+
+  CountMinSketch<uint16_t, std::string, uint32_t> b(a);
+  CountMinSketch<uint16_t, std::string, uint32_t> c =
+    CountMinSketch<uint16_t, std::string, uint32_t>::from_error(0.1, 0.5, 2u);
+  c = a;
+  a.clear();
+  CHECK(!a.exists(key(0)));
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK(b.exists(key(i)));
+    CHECK(c.exists(key(i)));
+  }
+}
+
+
+// skewed stream: key i appears n / (i + 1) times
+void test_estimate() {
+  const uint64_t n = 10000;
+  const uint64_t keys = 2000;
+  CountMinSketch<uint64_t, std::string, uint32_t> a =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.005, 0.01, 4u);
+  CountMinSketch<uint64_t, std::string, uint32_t> b =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.005, 0.01, 4u);
+  uint64_t err_a = 0;
+  uint64_t err_b = 0;
+
+  b.set_conservative(true);
+  CHECK(!a.conservative() && b.conservative());
+  for (uint64_t i = 0; i < keys; ++i) {
+    for (uint64_t j = 0; j < n / (i + 1); ++j) {
+      a.add(key(i));
+      b.add(key(i));
+    }
+  }
+  CHECK(a.total() == b.total());
+
+  for (uint64_t i = 0; i < keys; ++i) {
+    const uint32_t count = n / (i + 1);
+
+    CHECK(a.estimate(key(i)) >= count);
+    CHECK(b.estimate(key(i)) >= count);
+    CHECK(b.estimate(key(i)) <= a.estimate(key(i)));
+    CHECK(a.estimate(key(i)) <= count + 0.005 * a.total());
+    err_a += a.estimate(key(i)) - count;
+    err_b += b.estimate(key(i)) - count;
+  }
+  std::cout << "count-min: mean overestimate " << (double)err_a / keys 
+            << ", conservative " << (double)err_b / keys << std::endl;
+  CHECK(err_b * 2 < err_a);
+
+  // weighted adds count the same as repeated ones
+  CountMinSketch<uint64_t, std::string, uint32_t> c =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.005, 0.01, 4u);
+  for (uint64_t i = 0; i < keys; ++i) {
+    c.add(key(i), n / (i + 1));
+  }
+  CHECK(c.total() == a.total());
+  for (uint64_t i = 0; i < keys; ++i) {
+    CHECK(c.estimate(key(i)) == a.estimate(key(i)));
+  }
+  CHECK(c.estimate(key(keys)) <= 0.005 * c.total());
+  c.clear();
+  CHECK(c.estimate(key(0)) == 0);
+  CHECK(c.total() == 0);
+}
+
+
+template <class C>
+void test_batch(const double epsilon, const double delta) {
+  const uint64_t n = 5000;
+  CountMinSketch<uint64_t, uint64_t, C> a =
+    CountMinSketch<uint64_t, uint64_t, C>::from_error(epsilon, delta, 6u);
+  CountMinSketch<uint64_t, uint64_t, C> b =
+    CountMinSketch<uint64_t, uint64_t, C>::from_error(epsilon, delta, 6u);
+  std::vector<uint64_t> keys;
+  std::vector<C> out(2 * n);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    keys.push_back(i % (n / 3) * 7919);
+    a.add(keys[i]);
+  }
+  b.add_batch(&keys[0], n);
+  CHECK(a.total() == b.total());
+
+  for (uint64_t i = n; i < 2 * n; ++i) {
+    keys.push_back(i * 104729);
+  }
+  b.estimate_batch(&keys[0], keys.size(), &out[0]);
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    CHECK(a.estimate(keys[i]) == b.estimate(keys[i]));
+    CHECK(out[i] == a.estimate(keys[i]));
+  }
+  CHECK(b.estimate_batch(keys) == out);
+}
+
+void test_batch_fallback() {
+  std::vector<CountMinSketch<uint16_t, std::string, uint32_t>::hash_function> list;
+  std::vector<std::string> keys;
+
+  list.push_back(hash16<1>);
+  list.push_back(hash16<2>);
+  for (uint64_t i = 0; i < 100; ++i) {
+    keys.push_back(key(i % 10));
+  }
+
+  // hash_list rows and conservative update go key by key
+  CountMinSketch<uint16_t, std::string, uint32_t> a(list);
+  CountMinSketch<uint16_t, std::string, uint32_t> b =
+    CountMinSketch<uint16_t, std::string, uint32_t>::from_error(0.01, 0.01, 1u);
+  b.set_conservative(true);
+  a.add_batch(&keys[0], keys.size());
+  b.add_batch(&keys[0], keys.size());
+
+  std::vector<uint32_t> ea = a.estimate_batch(keys);
+  std::vector<uint32_t> eb = b.estimate_batch(keys);
+  for (uint64_t i = 0; i < keys.size(); ++i) {
+    CHECK(ea[i] == 10);
+    CHECK(eb[i] == 10);
+  }
+}
+
+
+void test_concurrent() {
+  const uint64_t n = 20000;
+  const uint32_t threads = 4;
+  ConcurrentCountMinSketch<uint64_t> a(0.001, 0.01, 8u);
+  CountMinSketch<uint64_t, uint64_t, uint32_t> b =
+    CountMinSketch<uint64_t, uint64_t, uint32_t>::from_error(0.001, 0.01, 8u);
+  std::vector<std::thread> pool;
+  std::atomic<bool> done(false);
+  uint64_t reads = 0;
+
+  for (uint64_t i = 0; i < threads * n; ++i) {
+    b.add(i % 1000);
+  }
+
+  // half the threads add directly, half through a Writer, while another
+  // thread queries
+  for (uint32_t t = 0; t < threads; ++t) {
+    pool.push_back(std::thread([&a, t, n]() {
+          ConcurrentCountMinSketch<uint64_t>::Writer w(a, 1000 + t);
+
+          for (uint64_t i = t; i < threads * n; i += threads) {
+            if (t & 1) {
+              w.add(i % 1000);
+            } else {
+              a.add(i % 1000);
+            }
+          }
+        }));
+  }
+  std::thread reader([&a, &done, &reads]() {
+      while (!done) {
+        reads += a.estimate(reads % 1000) <= threads * n;
+      }
+    });
+  for (uint32_t t = 0; t < threads; ++t) {
+    pool[t].join();
+  }
+  done = true;
+  reader.join();
+  CHECK(reads);
+
+  CHECK(a.width() == b.width() && a.depth() == b.depth());
+  CHECK(a.memory() == b.memory());
+  CHECK(a.total() == threads * n);
+  for (uint64_t i = 0; i < 2000; ++i) {
+    CHECK(a.estimate(i) == b.estimate(i));
+  }
+
+  // a Writer's counts are visible once flushed
+  ConcurrentCountMinSketch<uint64_t, uint64_t> c(0.01, 0.01);
+  ConcurrentCountMinSketch<uint64_t, uint64_t>::Writer w(c, 100);
+  for (uint64_t i = 0; i < 150; ++i) {
+    w.add(7);
+  }
+  CHECK(w.pending() == 50);
+  CHECK(c.estimate(7) == 100);
+  w.add(7, 10);
+  w.flush();
+  CHECK(w.pending() == 0);
+  CHECK(c.estimate(7) == 160);
+  CHECK(c.total() == 160);
+
+  // delta counters are one byte: larger counts reach the shared counters
+  // before the flush, the low byte with it
+  ConcurrentCountMinSketch<uint64_t, uint64_t>::Writer x(c, 1000000);
+  CountMinSketch<uint64_t, uint64_t, uint64_t> d =
+    CountMinSketch<uint64_t, uint64_t, uint64_t>::from_error(0.01, 0.01);
+  CHECK(x.memory() * sizeof(uint64_t) >= c.memory());
+  CHECK(x.memory() * sizeof(uint64_t) < c.memory() + 64 * sizeof(uint64_t));
+  d.add(7, 160);
+  x.add(9, 1000);
+  CHECK(c.estimate(9) == 768);
+  d.add(9, 1000);
+  for (uint64_t i = 0; i < 5000; ++i) {
+    x.add(i % 300, i & 7);
+    d.add(i % 300, i & 7);
+  }
+  CHECK(x.pending() == 5001);
+  x.flush();
+  CHECK(x.pending() == 0);
+  CHECK(c.total() == d.total());
+  for (uint64_t i = 0; i < 600; ++i) {
+    CHECK(c.estimate(i) == d.estimate(i));
+  }
+}
+
+
+void test_merge() {
+  const uint64_t n = 5000;
+  CountMinSketch<uint64_t, std::string, uint32_t> a =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.001, 0.01, 5u);
+  CountMinSketch<uint64_t, std::string, uint32_t> b =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.001, 0.01, 5u);
+  CountMinSketch<uint64_t, std::string, uint32_t> all =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.001, 0.01, 5u);
+  CountMinSketch<uint64_t, std::string, uint32_t> other =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.001, 0.01, 6u);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    a.add(key(i % 700));
+    b.add(key(i % 300 + 500), 2);
+    all.add(key(i % 700));
+    all.add(key(i % 300 + 500), 2);
+  }
+  CHECK(a.compatible(b));
+  CHECK(!a.compatible(other));
+  CHECK(!a.merge(other));
+
+  CountMinSketch<uint64_t, std::string, uint32_t> c(a);
+  CHECK(c.merge(b));
+  CHECK(c.total() == all.total());
+  for (uint64_t i = 0; i < 1000; ++i) {
+    CHECK(c.estimate(key(i)) == all.estimate(key(i)));
+  }
+
+  // straight from the wire, and into a sketch of another shape
+  const std::string wire = b.serialize();
+  CHECK(wire.size() == sizeof(CountMinWireHeader) + b.depth() * b.width() * sizeof(uint32_t));
+  CHECK(!other.merge(wire));
+  CHECK(!a.merge(wire.data(), wire.size() - 1));
+  CHECK(a.merge(wire));
+  CHECK(a.serialize() == all.serialize());
+
+  CountMinSketch<uint64_t, std::string, uint32_t> d =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.1, 0.5, 1u);
+  CountMinSketch<uint64_t, std::string, uint16_t> e =
+    CountMinSketch<uint64_t, std::string, uint16_t>::from_error(0.001, 0.01, 5u);
+  CHECK(!e.deserialize(wire));
+  CHECK(d.deserialize(wire));
+  CHECK(d.compatible(b));
+  CHECK(d.total() == b.total());
+  CHECK(d.deserialize(wire));
+  CHECK(d.total() == b.total());
+  for (uint64_t i = 0; i < 1000; ++i) {
+    CHECK(d.estimate(key(i)) == b.estimate(key(i)));
+  }
+  std::string bad = wire;
+  bad[0] = 'X';
+  CHECK(!d.deserialize(bad));
+
+  // counters saturate instead of wrapping
+  CountMinSketch<uint64_t, std::string, uint8_t> f =
+    CountMinSketch<uint64_t, std::string, uint8_t>::from_error(0.01, 0.01, 1u);
+  CountMinSketch<uint64_t, std::string, uint8_t> g =
+    CountMinSketch<uint64_t, std::string, uint8_t>::from_error(0.01, 0.01, 1u);
+  f.add(key(1), 200);
+  g.add(key(1), 100);
+  CHECK(f.merge(g.serialize()));
+  CHECK(f.estimate(key(1)) == 255);
+  CHECK(g.merge(g));
+  CHECK(g.estimate(key(1)) == 200);
+}
+
+
+void test_topk() {
+  const uint64_t heavy = 20;
+  const uint64_t light = 20000;
+  TopK<std::string> t(heavy, 0.001, 0.01, 2u);
+  uint64_t state = 1;
+
+  CHECK(t.capacity() == heavy && t.size() == 0 && t.min() == 0);
+  // heavy key i shows up 500 + 10i times, light keys once or twice,
+  // interleaved
+  for (uint64_t round = 0; round < 700; ++round) {
+    for (uint64_t i = 0; i < heavy; ++i) {
+      if (round < 500 + 10 * i) {
+        t.add(key(i));
+      }
+    }
+    for (uint64_t j = 0; j < 40; ++j) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      t.add(key(heavy + (state >> 33) % light));
+    }
+  }
+
+  const std::vector<std::pair<std::string, uint32_t> > top = t.topk();
+  CHECK(top.size() == heavy && t.size() == heavy);
+  for (uint64_t i = 0; i < heavy; ++i) {
+    // largest first
+    CHECK(top[i].first == key(heavy - 1 - i));
+    CHECK(top[i].second == t.estimate(top[i].first));
+    CHECK(top[i].second >= 500 + 10 * (heavy - 1 - i));
+    CHECK(t.contains(key(i)));
+  }
+  CHECK(!t.contains(key(heavy)));
+  CHECK(t.min() >= 500);
+
+  // a tiny heap under heavy churn keeps its index consistent
+  TopK<uint64_t> u(5, 0.01, 0.01);
+  for (uint64_t i = 0; i < 100000; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    u.add((state >> 40) % 3000, 1 + (state >> 60));
+  }
+  const std::vector<std::pair<uint64_t, uint32_t> > v = u.topk();
+  CHECK(v.size() == 5);
+  for (uint64_t i = 0; i < v.size(); ++i) {
+    CHECK(u.contains(v[i].first));
+    CHECK(i == 0 || v[i - 1].second >= v[i].second);
+  }
+  u.clear();
+  CHECK(u.size() == 0 && u.topk().empty() && !u.contains(v[0].first));
+}
+
+
+template <class K>
+void test_dyadic(const K scale) {
+  const uint64_t n = 50000;
+  const double epsilon = 0.001;
+  DyadicCountMin<K> d(epsilon, 0.01, 3u);
+  std::vector<K> values;
+  uint64_t state = 5;
+
+  // latencies: mostly small, with a long tail
+  for (uint64_t i = 0; i < n; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const uint64_t r = state >> 33;
+    const K v = (K)((r % 1000 + (r % 97 == 0 ? r % 100000 : 0)) * scale);
+
+    values.push_back(v);
+    d.add(v);
+  }
+  d.add(std::numeric_limits<K>::max(), 3);
+  values.insert(values.end(), 3, std::numeric_limits<K>::max());
+  std::sort(values.begin(), values.end());
+
+  CHECK(d.total() == n + 3);
+  CHECK(d.sketched_levels() > 0 && d.sketched_levels() < DyadicCountMin<K>::LEVELS);
+  CHECK(d.range_count(0, std::numeric_limits<K>::max()) == n + 3);
+  CHECK(d.range_count(std::numeric_limits<K>::max(), std::numeric_limits<K>::max()) >= 3);
+  CHECK(d.range_count(5, 4) == 0);
+
+  const double bound = 2.0 * DyadicCountMin<K>::BITS * epsilon * d.total();
+  for (uint64_t i = 0; i < 200; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const K lo = (K)((state >> 40) % 2000 * scale);
+    const K hi = lo + (K)((state >> 20) % 5000 * scale);
+    const uint64_t count = std::upper_bound(values.begin(), values.end(), hi) - 
+      std::lower_bound(values.begin(), values.end(), lo);
+    const uint64_t est = d.range_count(lo, hi);
+
+    CHECK(est >= count);
+    CHECK(est <= count + bound);
+  }
+
+  const double phis[] = {0.01, 0.5, 0.9, 0.99, 1.0};
+  for (uint64_t i = 0; i < 5; ++i) {
+    const K q = d.quantile(phis[i]);
+    // true rank of q, and of the key below it
+    const uint64_t at = std::upper_bound(values.begin(), values.end(), q) - values.begin();
+    const uint64_t below = std::lower_bound(values.begin(), values.end(), q) - values.begin();
+
+    CHECK(at + bound >= phis[i] * d.total());
+    CHECK(below <= phis[i] * d.total());
+  }
+
+  DyadicCountMin<K> e(d);
+  CHECK(e.range_count(0, 999 * scale) == d.range_count(0, 999 * scale));
+  d.clear();
+  CHECK(d.total() == 0 && d.range_count(0, std::numeric_limits<K>::max()) == 0);
+  CHECK(e.total() == n + 3);
+  d = e;
+  CHECK(d.estimate(values[0]) == e.estimate(values[0]));
+}
+
+
+void test_median() {
+  uint64_t state = 9;
+
+  for (uint32_t n = 1; n <= 12; ++n) {
+    // every 0/1 input (enough for a comparison network), then random ones
+    for (uint64_t bits = 0; bits < ((uint64_t)1 << n) + 1000; ++bits) {
+      int v[16];
+      int w[16];
+
+      for (uint32_t i = 0; i < n; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        v[i] = bits < ((uint64_t)1 << n) ? (int)((bits >> i) & 1) : (int)(state >> 59) - 16;
+        w[i] = v[i];
+      }
+      std::sort(w, w + n);
+      CHECK(cs_median(v, n) == w[n / 2]);
+    }
+  }
+}
+
+void test_count_sketch() {
+  const uint64_t keys = 5000;
+  const double epsilon = 0.05;
+  CountSketch<std::string> a(epsilon, 0.01, 7u);
+  CountSketch<std::string> b(epsilon, 0.01, 7u);
+  std::vector<int64_t> truth(keys, 0);
+  std::vector<std::string> stream;
+  double f2 = 0.0;
+
+  CHECK(a.depth() % 2 == 1);
+  CHECK(a.width() == cs_width(epsilon));
+  // the median of d rows fails with probability at most 2^-(d + 2)
+  CHECK(cs_depth(0.5) == 1 && cs_depth(0.01) == 5 && cs_depth(1e-6) == 19);
+  for (double delta = 0.9; delta > 1e-12; delta /= 3) {
+    CHECK(std::pow(2.0, -(double)cs_depth(delta) - 2) <= delta);
+  }
+  // Zipf-like inserts, then delete every third key outright and half of
+  // every fifth
+  for (uint64_t i = 0; i < keys; ++i) {
+    const int64_t count = 20000 / (i + 1) + 1;
+
+    for (int64_t j = 0; j < count; ++j) {
+      stream.push_back(key(i));
+    }
+    a.add(key(i), (int32_t)count);
+    truth[i] = count;
+  }
+  b.add_batch(&stream[0], stream.size());
+  for (uint64_t i = 0; i < keys; i += 3) {
+    a.remove(key(i), (int32_t)truth[i]);
+    b.remove(key(i), (int32_t)truth[i]);
+    truth[i] = 0;
+  }
+  for (uint64_t i = 1; i < keys; i += 5) {
+    a.remove(key(i), (int32_t)(truth[i] / 2));
+    b.remove(key(i), (int32_t)(truth[i] / 2));
+    truth[i] -= truth[i] / 2;
+  }
+  for (uint64_t i = 0; i < keys; ++i) {
+    f2 += (double)truth[i] * truth[i];
+  }
+
+  // batched and single adds land in the same counters
+  std::vector<std::string> all;
+  for (uint64_t i = 0; i < keys; ++i) {
+    all.push_back(key(i));
+  }
+  const std::vector<int32_t> est = b.estimate_batch(all);
+  uint64_t outside = 0;
+  for (uint64_t i = 0; i < keys; ++i) {
+    CHECK(est[i] == a.estimate(key(i)));
+    outside += std::abs(est[i] - truth[i]) > epsilon * std::sqrt(f2);
+  }
+  CHECK(outside * 100 < keys);
+  CHECK(a.estimate(key(0)) == 0);
+  CHECK(std::fabs(a.f2() - f2) < 0.1 * f2);
+
+  CountSketch<std::string> c(a);
+  CHECK(c.estimate(key(1)) == a.estimate(key(1)));
+  c.clear();
+  CHECK(c.f2() == 0.0 && c.estimate(key(1)) == 0);
+  c = b;
+  CHECK(c.estimate(key(1)) == a.estimate(key(1)));
+
+  // tighter than Count-Min at the same memory on a skewed stream, with
+  // fewer counters per row than keys
+  const uint64_t width = 1200;
+  CountMinSketch<uint64_t, std::string, uint32_t> m =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(std::exp(1.0) / width, 0.01, 7u);
+  uint64_t err_cs = 0;
+  uint64_t err_cm = 0;
+  for (uint64_t i = 0; i < keys; ++i) {
+    m.add(key(i), 20000 / (i + 1) + 1);
+  }
+  CountSketch<std::string> d(width, m.depth(), 7u);
+  for (uint64_t i = 0; i < keys; ++i) {
+    d.add(key(i), 20000 / (i + 1) + 1);
+  }
+  for (uint64_t i = 0; i < keys; ++i) {
+    const int64_t count = 20000 / (i + 1) + 1;
+
+    err_cs += std::abs(d.estimate(key(i)) - count);
+    err_cm += m.estimate(key(i)) - count;
+  }
+  std::cout << "count sketch: mean error " << (double)err_cs / keys 
+            << ", count-min " << (double)err_cm / keys << std::endl;
+  CHECK(err_cs < err_cm);
+}
+
+
+void test_counter_policy() {
+  CountMinSketch<uint64_t, std::string, CmsSaturating<uint8_t> > s8 =
+    CountMinSketch<uint64_t, std::string, CmsSaturating<uint8_t> >::from_error(0.01, 0.01, 1u);
+  CountMinSketch<uint64_t, std::string, CmsSaturating<uint16_t> > s16 =
+    CountMinSketch<uint64_t, std::string, CmsSaturating<uint16_t> >::from_error(0.01, 0.01, 1u);
+  CountMinSketch<uint64_t, std::string, uint32_t> plain =
+    CountMinSketch<uint64_t, std::string, uint32_t>::from_error(0.01, 0.01, 1u);
+  std::vector<std::string> keys(300, key(1));
+
+  // rows are padded to cache lines, so a little over 1/4 and 1/2
+  CHECK(s8.memory() * 3 < plain.memory() && s16.memory() * 3 < plain.memory() * 2);
+  // saturating counters stick at their maximum, one at a time or batched
+  s8.add_batch(&keys[0], keys.size());
+  CHECK(s8.estimate(key(1)) == 255);
+  s8.add(key(2), 200);
+  s8.add(key(2), 200);
+  CHECK(s8.estimate(key(2)) == 255);
+  s16.add(key(1), 60000);
+  s16.add(key(1), 60000);
+  CHECK(s16.estimate(key(1)) == 65535);
+  s16.add(key(3), 7);
+  CHECK(s16.estimate(key(3)) == 7);
+
+  // approximate counters: 1 byte, unbiased over many keys
+  typedef CountMinSketch<uint64_t, std::string, CmsMorris<> > Morris;
+  Morris m = Morris::from_error(0.01, 0.01, 1u);
+  Morris batch = Morris::from_error(0.01, 0.01, 1u);
+  std::vector<std::string> stream;
+  double ratio = 0.0;
+
+  CHECK(m.memory() == s8.memory());
+  CHECK(!m.exists(key(0)));
+  m.add(key(0));
+  CHECK(m.estimate(key(0)) == 1);
+  m.clear();
+  for (uint64_t i = 0; i < 20; ++i) {
+    for (uint64_t j = 0; j < 1000 * (i + 1); ++j) {
+      m.add(key(i));
+      stream.push_back(key(i));
+    }
+  }
+  batch.add_batch(&stream[0], stream.size());
+  CHECK(m.total() == stream.size() && batch.total() == stream.size());
+  for (uint64_t i = 0; i < 20; ++i) {
+    const double count = 1000.0 * (i + 1);
+
+    CHECK(m.estimate(key(i)) > 0.4 * count && m.estimate(key(i)) < 1.6 * count);
+    CHECK(batch.estimate(key(i)) > 0.4 * count && batch.estimate(key(i)) < 1.6 * count);
+    ratio += m.estimate(key(i)) / count;
+  }
+  CHECK(std::fabs(ratio / 20 - 1.0) < 0.15);
+
+  // weighted adds and merges go by value, not by cell
+  Morris w = Morris::from_error(0.01, 0.01, 1u);
+  for (uint64_t i = 0; i < 20; ++i) {
+    w.add(key(i), 1000 * (i + 1));
+  }
+  CHECK(w.estimate(key(19)) > 10000 && w.estimate(key(19)) < 30000);
+  const std::vector<uint64_t> before = w.estimate_batch(std::vector<std::string>(1, key(19)));
+  CHECK(w.merge(m.serialize()));
+  CHECK(w.estimate(key(19)) > before[0]);
+  CHECK(w.estimate(key(19)) > 25000 && w.estimate(key(19)) < 55000);
+  // cells of the same size but another policy are refused
+  CountMinSketch<uint64_t, std::string, uint8_t> narrow =
+    CountMinSketch<uint64_t, std::string, uint8_t>::from_error(0.01, 0.01, 1u);
+  CountMinSketch<uint64_t, std::string, CmsMorris<5> > finer =
+    CountMinSketch<uint64_t, std::string, CmsMorris<5> >::from_error(0.01, 0.01, 1u);
+  CHECK(!plain.merge(m.serialize()));
+  CHECK(!narrow.merge(m.serialize()));
+  CHECK(!finer.merge(m.serialize()));
+  CHECK(s8.merge(narrow.serialize()));
+
+  // counter policies carry through to TopK
+  TopK<std::string, CmsMorris<> > top(5, 0.01, 0.01);
+  for (uint64_t i = 0; i < stream.size(); ++i) {
+    top.add(stream[i]);
+  }
+  CHECK(top.topk()[0].first == key(19));
+}
+
+
+// cms_offsets against DoubleHash and cms_column, including a width of
+// 2^32 (a uint32_t hash type), which the AVX2 kernel can't multiply by
+void test_offsets() {
+  const uint64_t widths[] = {1, 27183, 0xffffffffULL, (uint64_t)1 << 32};
+  std::vector<uint64_t> keys;
+
+  for (uint64_t i = 0; i < CMS_BATCH_SIZE; ++i) {
+    keys.push_back(i * 0x9e3779b97f4a7c15ULL);
+  }
+  for (uint64_t w = 0; w < 4; ++w) {
+    for (uint32_t depth = 1; depth <= 9; ++depth) {
+      std::vector<uint64_t> off(CMS_BATCH_SIZE * depth);
+      std::vector<uint64_t> sign(CMS_BATCH_SIZE * depth);
+
+      cms_offsets(&keys[0], CMS_BATCH_SIZE, 3, depth, widths[w], 64, &off[0], &sign[0]);
+      for (uint64_t j = 0; j < CMS_BATCH_SIZE; ++j) {
+        const DoubleHash h(keys[j], 3u);
+
+        // a uint64_t key with a literal seed is hashed, not taken as h1
+        CHECK(DoubleHash(keys[j], 0).h1() != keys[j]);
+        for (uint32_t i = 0; i < depth; ++i) {
+          CHECK(off[j * depth + i] == i * 64 + cms_column(h[i], widths[w]));
+          CHECK(sign[j * depth + i] == ((h[i] >> 31) & 1));
+        }
+      }
+    }
+  }
+}
+
+
+int main() {
+  test_sizing();
+  test_counter_type();
+  test_estimate();
+  // depths 3, 5, 7, 9 and 5
+  test_batch<uint32_t>(0.01, 0.05);
+  test_batch<uint64_t>(0.001, 0.01);
+  test_batch<uint16_t>(0.01, 0.001);
+  test_batch<uint8_t>(0.01, 0.0003);
+  test_batch<int32_t>(0.01, 0.01);
+  test_batch_fallback();
+  test_offsets();
+  test_concurrent();
+  test_merge();
+  test_topk();
+  test_dyadic<uint32_t>(1);
+  test_dyadic<uint64_t>(1000000007);
+  test_median();
+  test_count_sketch();
+  test_counter_policy();
+
+  std::cout << "all tests passed" << std::endl;
+  return (0);
+}
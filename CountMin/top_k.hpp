@@ -0,0 +1,288 @@
+/*
+ * top_k.hpp
+ *
+ *
+ * Count-Min Top-k Heavy Hitters
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __TOP_K__
+#define __TOP_K__
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include <stdint.h>
+
+#include "count_min_sketch.hpp"
+
+
+// The k keys with the largest estimated counts in a stream, tracked with
+// a CountMinSketch and a min-heap of at most k candidates ordered by
+// their estimate. Each add() updates the sketch, and the key enters the
+// heap only if its new estimate exceeds the heap minimum (which is then
+// evicted). The heap is indexed by an open addressing table keyed on the
+// same 128 bit hash the sketch uses, so a key is hashed once per add().
+//
+// Heap counts are the estimates at a key's last add(); topk() reports
+// the current estimates.
+template <class T, class C = uint32_t>
+class TopK {
+public:
+  // counts and estimates (C, unless C is a counter policy)
+  typedef typename CountMinSketch<uint64_t, T, C>::value_type value_type;
+
+  // Track k keys with a sketch of the given error bounds (see
+  // CountMinSketch::from_error())
+  TopK(const uint32_t k, const double epsilon, const double delta, const uint32_t seed = 0) :
+    k_(k),
+    sketch_(CountMinSketch<uint64_t, T, C>::from_error(epsilon, delta, seed)),
+    slots_(table_size(k), 0),
+    mask_(slots_.size() - 1)
+  {
+    assert(k);
+    heap_.reserve(k);
+  }
+
+  void add(const T &s, const value_type count = 1) {
+    const DoubleHash h = sketch_.hash(s);
+    const value_type est = sketch_.add(s, h, count);
+    const uint64_t slot = find(s, h.h1());
+
+    if (slots_[slot]) {
+      const uint32_t pos = slots_[slot] - 1;
+
+      heap_[pos].count = est;
+      sift_down(pos);
+    } else if (heap_.size() < k_) {
+      heap_.push_back(Entry(s, h, est, slot));
+      slots_[slot] = (uint32_t)heap_.size();
+      sift_up((uint32_t)heap_.size() - 1);
+    } else if (est > heap_[0].count) {
+      erase_slot(heap_[0].slot);
+      // the erase may have moved the empty slot of s
+      const uint64_t empty = find(s, h.h1());
+
+      heap_[0] = Entry(s, h, est, empty);
+      slots_[empty] = 1;
+      sift_down(0);
+    }
+  }
+
+  value_type estimate(const T &s) const {
+    return (sketch_.estimate(s));
+  }
+
+  bool contains(const T &s) const {
+    const DoubleHash h = sketch_.hash(s);
+
+    return (slots_[find(s, h.h1())] != 0);
+  }
+
+  // The tracked keys with their current estimates, largest first
+  std::vector<std::pair<T, value_type> > topk() const {
+    std::vector<std::pair<T, value_type> > ret;
+
+    ret.reserve(heap_.size());
+    for (uint32_t i = 0; i < heap_.size(); ++i) {
+      const Entry &e = heap_[i];
+
+      ret.push_back(std::make_pair(e.key, sketch_.estimate(e.key, DoubleHash::from_halves(e.h1, e.h2))));
+    }
+    std::sort(ret.begin(), ret.end(), by_count);
+
+    return (ret);
+  }
+
+  // smallest count in the heap, 0 until k keys are tracked
+  value_type min() const {
+    return (heap_.size() < k_ ? 0 : heap_[0].count);
+  }
+
+  // number of tracked keys
+  uint32_t size() const {
+    return ((uint32_t)heap_.size());
+  }
+
+  uint32_t capacity() const {
+    return (k_);
+  }
+
+  const CountMinSketch<uint64_t, T, C> &sketch() const {
+    return (sketch_);
+  }
+
+  void set_conservative(const bool on) {
+    sketch_.set_conservative(on);
+  }
+
+  void clear() {
+    sketch_.clear();
+    heap_.clear();
+    std::fill(slots_.begin(), slots_.end(), 0);
+  }
+
+private:
+
+  struct Entry {
+    Entry(const T &s, const DoubleHash &h, const value_type c, const uint64_t i) :
+      key(s), h1(h.h1()), h2(h.h2()), count(c), slot(i) {}
+
+    T key;
+    uint64_t h1;
+    uint64_t h2;
+    value_type count;
+    // index in slots_
+    uint64_t slot;
+  };
+
+  // power of two, at most half full
+  static uint64_t table_size(const uint32_t k) {
+    uint64_t ret = 2;
+
+    while (ret < 2 * (uint64_t)k) {
+      ret <<= 1;
+    }
+
+    return (ret);
+  }
+
+  static bool by_count(const std::pair<T, value_type> &a, const std::pair<T, value_type> &b) {
+    return (a.second > b.second);
+  }
+
+  inline uint64_t home(const uint64_t h1) const {
+    return ((h1 >> 32) & mask_);
+  }
+
+  // slot holding s, or the empty slot where it would go (linear probing)
+  uint64_t find(const T &s, const uint64_t h1) const {
+    uint64_t i = home(h1);
+
+    while (slots_[i]) {
+      const Entry &e = heap_[slots_[i] - 1];
+
+      if (e.h1 == h1 && e.key == s) {
+        break;
+      }
+      i = (i + 1) & mask_;
+    }
+
+    return (i);
+  }
+
+  // Empty slot i, shifting later entries of the probe run back so that
+  // no lookup stops early
+  void erase_slot(uint64_t i) {
+    uint64_t j = i;
+
+    slots_[i] = 0;
+    for (;;) {
+      j = (j + 1) & mask_;
+      if (!slots_[j]) {
+        return;
+      }
+
+      const uint64_t h = home(heap_[slots_[j] - 1].h1);
+      // move j to i unless its home lies cyclically in (i, j]
+      if (i <= j ? (i < h && h <= j) : (i < h || h <= j)) {
+        continue;
+      }
+      slots_[i] = slots_[j];
+      heap_[slots_[i] - 1].slot = i;
+      slots_[j] = 0;
+      i = j;
+    }
+  }
+
+  inline void swap(const uint32_t a, const uint32_t b) {
+    std::swap(heap_[a], heap_[b]);
+    slots_[heap_[a].slot] = a + 1;
+    slots_[heap_[b].slot] = b + 1;
+  }
+
+  void sift_up(uint32_t i) {
+    while (i) {
+      const uint32_t parent = (i - 1) / 2;
+
+      if (heap_[parent].count <= heap_[i].count) {
+        return;
+      }
+      swap(i, parent);
+      i = parent;
+    }
+  }
+
+  void sift_down(uint32_t i) {
+    const uint32_t n = (uint32_t)heap_.size();
+
+    for (;;) {
+      const uint32_t l = 2 * i + 1;
+      const uint32_t r = l + 1;
+      uint32_t m = i;
+
+      if (l < n && heap_[l].count < heap_[m].count) {
+        m = l;
+      }
+      if (r < n && heap_[r].count < heap_[m].count) {
+        m = r;
+      }
+      if (m == i) {
+        return;
+      }
+      swap(i, m);
+      i = m;
+    }
+  }
+
+  uint32_t k_;
+  CountMinSketch<uint64_t, T, C> sketch_;
+  std::vector<Entry> heap_;
+  // heap position + 1 of the entry in each slot, 0 if empty
+  std::vector<uint32_t> slots_;
+  uint64_t mask_;
+};
+
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * double_hash.hpp
+ *
+ *
+ * Double Hashing (Kirsch-Mitzenmacher) over a single 128 bit MurmurHash3
+ *
+ *
+ * Copyright (C) 2026  Bryant Moscon - bmoscon@gmail.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution, and in the same 
+ *    place and form as other copyright,
+ *    license and disclaimer information.
+ *
+ * 3. The end-user documentation included with the redistribution, if any, must 
+ *    include the following acknowledgment: "This product includes software 
+ *    developed by Bryant Moscon (http://www.bryantmoscon.org/)", in the same 
+ *    place and form as other third-party acknowledgments. Alternately, this 
+ *    acknowledgment may appear in the software itself, in the same form and 
+ *    location as other such third-party acknowledgments.
+ *
+ * 4. Except as contained in this notice, the name of the author, Bryant Moscon,
+ *    shall not be used in advertising or otherwise to promote the sale, use or 
+ *    other dealings in this Software without prior written authorization from 
+ *    the author.
+ *
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN 
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef __DOUBLE_HASH__
+#define __DOUBLE_HASH__
+
+#include <string>
+#include <stdint.h>
+
+#include "MurmurHash3.hpp"
+
+
+// Hash the raw bytes of a key. Overload murmur_128 for key types whose
+// object representation is not their value (pointers, padding, etc).
+template <class T>
+inline void murmur_128(const T &key, const uint32_t seed, uint64_t *out) {
+  MurmurHash3_x64_128(&key, sizeof(T), seed, out);
+}
+
+inline void murmur_128(const std::string &key, const uint32_t seed, uint64_t *out) {
+  MurmurHash3_x64_128(key.data(), (int)key.length(), seed, out);
+}
+
+
+// k hash values from one hash computation, as described in "Less Hashing,
+// Same Performance: Building a Better Bloom Filter" by A. Kirsch and 
+// M. Mitzenmacher. The i-th value is h1 + i*h2 + (i^3 - i)/6 (enhanced
+// double hashing), which avoids the degenerate cycles of plain h1 + i*h2.
+class DoubleHash {
+public:
+
+  DoubleHash() : h1_(0), h2_(0) {}
+
+  template <class T>
+  DoubleHash(const T &key, const uint32_t seed) {
+    uint64_t out[2];
+    
+    murmur_128(key, seed, out);
+    h1_ = out[0];
+    h2_ = out[1];
+  }
+
+  // From two already computed halves. This is a named factory rather than
+  // a constructor, which DoubleHash(uint64_t key, 0) would resolve to.
+  static DoubleHash from_halves(const uint64_t h1, const uint64_t h2) {
+    DoubleHash h;
+
+    h.h1_ = h1;
+    h.h2_ = h2;
+    return (h);
+  }
+
+  inline uint64_t operator[](const uint64_t i) const {
+    return (h1_ + i * h2_ + (i * i * i - i) / 6);
+  }
+
+  uint64_t h1() const {
+    return (h1_);
+  }
+
+  uint64_t h2() const {
+    return (h2_);
+  }
+
+private:
+  uint64_t h1_;
+  uint64_t h2_;
+};
+
+
+#endif